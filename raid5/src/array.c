@@ -0,0 +1,360 @@
+#define _FILE_OFFSET_BITS 64
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raid5.h"
+#include "xor.h"
+
+#define READ_ALLOCATE_STRIPES 4 // reads spanning more stripes than this bypass the cache
+
+// one cached stripe: its data blocks and which of them are loaded and modified
+typedef struct entry {
+    int64_t stripe; // -1 while unused
+    unsigned char *data; // N-1 blocks in data order
+    unsigned char *valid, *dirty; // one flag per data block
+    int numValid, numDirty;
+    struct entry *prev, *next; // LRU list, most recently used first
+    struct entry *hashNext; // bucket chain
+} entry_t;
+
+struct raid5 {
+    raid5_geom_t g;
+    disk_t *disks;
+    entry_t *entries, *head, *tail;
+    entry_t **buckets;
+    int numEntries, numBuckets; // numBuckets is a power of two
+    unsigned char *parity, *old; // scratch blocks for flushing
+    raid5_stats_t stats;
+    pthread_mutex_t lock; // one call at a time
+};
+
+static entry_t **bucketOf(raid5_t *r, int64_t stripe) {
+    uint64_t h = (uint64_t)stripe * 0x9e3779b97f4a7c15ULL; // Fibonacci hashing
+    return &r->buckets[(h >> 32) & (r->numBuckets - 1)];
+}
+
+static entry_t *lookup(raid5_t *r, int64_t stripe) {
+    for (entry_t *e = *bucketOf(r, stripe); e; e = e->hashNext) {
+        if (e->stripe == stripe) return e;
+    }
+    return NULL;
+}
+
+static void unlinkLru(raid5_t *r, entry_t *e) {
+    if (e->prev) e->prev->next = e->next; else r->head = e->next;
+    if (e->next) e->next->prev = e->prev; else r->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void pushFront(raid5_t *r, entry_t *e) {
+    e->next = r->head;
+    e->prev = NULL;
+    if (r->head) r->head->prev = e; else r->tail = e;
+    r->head = e;
+}
+
+static void unhash(raid5_t *r, entry_t *e) {
+    for (entry_t **p = bucketOf(r, e->stripe); *p; p = &(*p)->hashNext) {
+        if (*p == e) {
+            *p = e->hashNext;
+            break;
+        }
+    }
+    e->hashNext = NULL;
+}
+
+static int loadBlock(raid5_t *r, entry_t *e, int index) {
+    int disk = raid5_data_disk(&r->g, e->stripe, index);
+    if (disk_read(&r->disks[disk], e->data + index * r->g.B, r->g.B, e->stripe * r->g.B) != 0) {
+        perror(r->disks[disk].path);
+        return -1;
+    }
+    e->valid[index] = 1;
+    e->numValid++;
+    return 0;
+}
+
+// write a dirty stripe back, computing its parity exactly once
+static int flushEntry(raid5_t *r, entry_t *e) {
+    if (e->numDirty == 0) return 0;
+    int perStripe = r->g.N - 1;
+    int64_t B = r->g.B, diskOff = e->stripe * B;
+    int parityDisk = raid5_parity_disk(&r->g, e->stripe);
+    int missingBlocks = perStripe - e->numValid;
+
+    if (missingBlocks <= e->numDirty + 1) {
+        // full stripe, or cheap to complete: parity from the data alone
+        for (int i = 0; i < perStripe; i++) {
+            if (!e->valid[i] && loadBlock(r, e, i) != 0) return -1;
+        }
+        memset(r->parity, 0, B);
+        for (int i = 0; i < perStripe; i++) {
+            xor_into(r->parity, e->data + i * B, B);
+        }
+        if (missingBlocks == 0) r->stats.fullStripeWrites++; else r->stats.reconstructWrites++;
+    } else {
+        // read-modify-write: P ^= old ^ new for each dirty block, old data still on disk
+        if (disk_read(&r->disks[parityDisk], r->parity, B, diskOff) != 0) {
+            perror(r->disks[parityDisk].path);
+            return -1;
+        }
+        for (int i = 0; i < perStripe; i++) {
+            if (!e->dirty[i]) continue;
+            int disk = raid5_data_disk(&r->g, e->stripe, i);
+            if (disk_read(&r->disks[disk], r->old, B, diskOff) != 0) {
+                perror(r->disks[disk].path);
+                return -1;
+            }
+            xor_into(r->parity, r->old, B);
+            xor_into(r->parity, e->data + i * B, B);
+        }
+        r->stats.rmwWrites++;
+    }
+
+    for (int i = 0; i < perStripe; i++) {
+        if (!e->dirty[i]) continue;
+        int disk = raid5_data_disk(&r->g, e->stripe, i);
+        if (disk_write(&r->disks[disk], e->data + i * B, B, diskOff) != 0) {
+            perror(r->disks[disk].path);
+            return -1;
+        }
+    }
+    if (disk_write(&r->disks[parityDisk], r->parity, B, diskOff) != 0) {
+        perror(r->disks[parityDisk].path);
+        return -1;
+    }
+    memset(e->dirty, 0, perStripe);
+    e->numDirty = 0;
+    return 0;
+}
+
+// find the stripe in the cache or recycle the least recently used entry for it
+static entry_t *acquire(raid5_t *r, int64_t stripe, int *hit) {
+    entry_t *e = lookup(r, stripe);
+    *hit = e != NULL;
+    if (!e) {
+        e = r->tail;
+        if (e->stripe >= 0) {
+            if (flushEntry(r, e) != 0) return NULL;
+            unhash(r, e);
+        }
+        e->stripe = stripe;
+        memset(e->valid, 0, r->g.N - 1);
+        e->numValid = 0;
+        entry_t **bucket = bucketOf(r, stripe);
+        e->hashNext = *bucket;
+        *bucket = e;
+    }
+    unlinkLru(r, e);
+    pushFront(r, e);
+    return e;
+}
+
+raid5_t *raid5_open(const raid5_geom_t *g, char **paths, int hex, int cacheStripes) {
+    if (!raid5_geom_valid(g) || cacheStripes < 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int N = g->N, perStripe = N - 1;
+    raid5_t *r = calloc(1, sizeof(raid5_t));
+    if (!r) return NULL;
+    pthread_mutex_init(&r->lock, NULL);
+    r->g = *g;
+    r->numEntries = cacheStripes;
+    r->numBuckets = 1;
+    while (r->numBuckets < 2 * cacheStripes) r->numBuckets *= 2;
+    r->disks = calloc(N, sizeof(disk_t));
+    r->entries = calloc(cacheStripes, sizeof(entry_t));
+    r->buckets = calloc(r->numBuckets, sizeof(entry_t *));
+    r->parity = malloc(g->B);
+    r->old = malloc(g->B);
+    if (!r->disks || !r->entries || !r->buckets || !r->parity || !r->old) {
+        raid5_close(r);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (int i = 0; i < cacheStripes; i++) {
+        entry_t *e = &r->entries[i];
+        e->stripe = -1;
+        e->data = malloc(perStripe * g->B);
+        e->valid = calloc(perStripe, 1);
+        e->dirty = calloc(perStripe, 1);
+        if (!e->data || !e->valid || !e->dirty) {
+            raid5_close(r);
+            errno = ENOMEM;
+            return NULL;
+        }
+        pushFront(r, e);
+    }
+
+    for (int d = 0; d < N; d++) {
+        if (disk_open(&r->disks[d], paths[d], hex, O_RDWR) != 0) {
+            int saved = errno;
+            raid5_close(r);
+            errno = saved;
+            return NULL;
+        }
+        if (disk_size(&r->disks[d]) < g->K) {
+            raid5_close(r);
+            errno = EIO; // member smaller than the geometry says
+            return NULL;
+        }
+    }
+    return r;
+}
+
+int raid5_pread(raid5_t *r, void *buf, int64_t len, int64_t off) {
+    if (off < 0 || len < 0 || off + len > raid5_capacity(&r->g)) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_mutex_lock(&r->lock);
+    int perStripe = r->g.N - 1, status = 0;
+    int64_t B = r->g.B, end = off + len;
+    int allocate = (end - 1) / B / perStripe - off / B / perStripe < READ_ALLOCATE_STRIPES; // small reads fill the cache
+    int64_t runStart = -1; // uncached bytes not yet read from disk
+
+    for (int64_t pos = off; status == 0 && pos <= end; ) {
+        entry_t *e = NULL;
+        int64_t block = pos / B, stripe = block / perStripe;
+        int index = (int)(block % perStripe);
+        int64_t start = pos % B, n = B - start < end - pos ? B - start : end - pos;
+        if (pos < end) {
+            if (allocate) {
+                int hit;
+                e = acquire(r, stripe, &hit);
+                if (!e) {
+                    status = -1;
+                    break;
+                }
+            } else {
+                e = lookup(r, stripe);
+            }
+        }
+        int cached = e && e->valid[index];
+        if (pos < end) {
+            if (cached) r->stats.hits++; else r->stats.misses++;
+        }
+
+        if ((cached || pos == end) && runStart >= 0) { // bulk read of the uncached run so far
+            status = raid5_read(&r->g, r->disks, -1, (unsigned char *)buf + runStart - off, pos - runStart, runStart);
+            runStart = -1;
+        }
+        if (pos == end) break;
+        if (allocate && !cached && loadBlock(r, e, index) != 0) { // read-allocate
+            status = -1;
+            break;
+        }
+        if (e && e->valid[index]) {
+            memcpy((unsigned char *)buf + pos - off, e->data + index * B + start, n);
+        } else if (runStart < 0) {
+            runStart = pos;
+        }
+        pos += n;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return status;
+}
+
+int raid5_pwrite(raid5_t *r, const void *buf, int64_t len, int64_t off) {
+    if (off < 0 || len < 0 || off + len > raid5_capacity(&r->g)) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_mutex_lock(&r->lock);
+    int perStripe = r->g.N - 1, status = 0;
+    int64_t B = r->g.B, end = off + len, lastStripe = -1;
+    r->stats.writes++;
+    entry_t *e = NULL;
+    for (int64_t pos = off; pos < end; ) {
+        int64_t block = pos / B, stripe = block / perStripe;
+        int index = (int)(block % perStripe);
+        int64_t start = pos % B, n = B - start < end - pos ? B - start : end - pos;
+        if (stripe != lastStripe) {
+            int hit;
+            e = acquire(r, stripe, &hit);
+            if (!e) {
+                status = -1;
+                break;
+            }
+            if (e->numDirty > 0) r->stats.coalesced++; // parity for this write is folded into a pending flush
+            lastStripe = stripe;
+        }
+        if (e->valid[index]) r->stats.hits++; else r->stats.misses++;
+        if (n < B && !e->valid[index] && loadBlock(r, e, index) != 0) { // partial block: fetch the rest first
+            status = -1;
+            break;
+        }
+        memcpy(e->data + index * B + start, (const unsigned char *)buf + pos - off, n);
+        if (!e->valid[index]) {
+            e->valid[index] = 1;
+            e->numValid++;
+        }
+        if (!e->dirty[index]) {
+            e->dirty[index] = 1;
+            e->numDirty++;
+        }
+        pos += n;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return status;
+}
+
+static int byStripe(const void *a, const void *b) {
+    int64_t x = (*(entry_t *const *)a)->stripe, y = (*(entry_t *const *)b)->stripe;
+    return (x > y) - (x < y);
+}
+
+int raid5_flush(raid5_t *r) {
+    pthread_mutex_lock(&r->lock);
+    entry_t **dirty = malloc(r->numEntries * sizeof(entry_t *));
+    int count = 0, status = dirty ? 0 : -1;
+    for (int i = 0; dirty && i < r->numEntries; i++) {
+        if (r->entries[i].numDirty > 0) dirty[count++] = &r->entries[i];
+    }
+    if (dirty) qsort(dirty, count, sizeof(entry_t *), byStripe); // write back in disk order
+    for (int i = 0; status == 0 && i < count; i++) {
+        status = flushEntry(r, dirty[i]);
+    }
+    free(dirty);
+    pthread_mutex_unlock(&r->lock);
+    return status;
+}
+
+int raid5_close(raid5_t *r) {
+    if (!r) return 0;
+    int status = 0;
+    if (r->entries) status = raid5_flush(r);
+    for (int i = 0; r->entries && i < r->numEntries; i++) {
+        free(r->entries[i].data);
+        free(r->entries[i].valid);
+        free(r->entries[i].dirty);
+    }
+    for (int d = 0; r->disks && d < r->g.N; d++) {
+        if (r->disks[d].path) disk_close(&r->disks[d]); // only members disk_open got to
+    }
+    pthread_mutex_destroy(&r->lock);
+    free(r->disks);
+    free(r->entries);
+    free(r->buckets);
+    free(r->parity);
+    free(r->old);
+    free(r);
+    return status;
+}
+
+void raid5_get_stats(raid5_t *r, raid5_stats_t *stats) {
+    pthread_mutex_lock(&r->lock);
+    *stats = r->stats;
+    pthread_mutex_unlock(&r->lock);
+}
+
+double raid5_hit_ratio(const raid5_stats_t *stats) {
+    int64_t total = stats->hits + stats->misses;
+    return total ? (double)stats->hits / total : 0.0;
+}
@@ -0,0 +1,321 @@
+#define _GNU_SOURCE // getopt under -std=c99
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "gf256.h"
+#include "io.h"
+#include "raid5.h"
+#include "xor.h"
+
+// throughput of every layout across a range of chunk sizes
+
+#define READ_STEP (1 << 22) // logical bytes per raid5_read call
+
+static const int64_t chunkSizes[] = {4 << 10, 64 << 10, 1 << 20, 4 << 20};
+#define NUM_CHUNKS (int)(sizeof(chunkSizes) / sizeof(chunkSizes[0]))
+
+// disk size of one case: the logical size spread over N - 1 data disks, rounded up to whole chunks
+static int64_t caseDiskSize(int64_t size, int N, int64_t B) {
+    return (size / (N - 1) + B - 1) / B * B;
+}
+
+// input big enough for every case over these disk counts, since each encodes its whole capacity
+static int64_t inputSize(int64_t size, const int *disks, int numDisks) {
+    int64_t largest = 0;
+    for (int n = 0; n < numDisks; n++) {
+        for (int c = 0; c < NUM_CHUNKS; c++) {
+            int64_t capacity = caseDiskSize(size, disks[n], chunkSizes[c]) * (disks[n] - 1);
+            if (capacity > largest) largest = capacity;
+        }
+    }
+    return largest;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+// write size random bytes to path
+static int makeInput(const char *path, int64_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    unsigned char buf[1 << 16];
+    unsigned int x = 12345;
+    for (int64_t done = 0; done < size; done += sizeof(buf)) {
+        for (size_t i = 0; i < sizeof(buf); i++) {
+            x = x * 1103515245 + 12345;
+            buf[i] = (unsigned char)(x >> 16);
+        }
+        int64_t n = size - done < (int64_t)sizeof(buf) ? size - done : (int64_t)sizeof(buf);
+        if ((int64_t)fwrite(buf, 1, n, f) != n) {
+            fclose(f);
+            return -1;
+        }
+    }
+    return fclose(f);
+}
+
+// in-memory parity rate for N-2 data blocks: P alone (XOR) against P+Q, in GB/s of data
+static int kernelRates(int N, double *pRate, double *pqRate) {
+    const int64_t B = 64 << 10, rounds = 2000;
+    int n = N - 2 > 0 ? N - 2 : 1;
+    unsigned char *buf = malloc((size_t)((n + 2) * B));
+    if (!buf) return -1;
+    const unsigned char *data[RAID5_MAX_DISKS];
+    for (int64_t i = 0; i < (n + 2) * B; i++) {
+        buf[i] = (unsigned char)(i * 2654435761u >> 13);
+    }
+    for (int i = 0; i < n; i++) {
+        data[i] = buf + i * B;
+    }
+    unsigned char *p = buf + n * B, *q = p + B;
+
+    double start = now();
+    for (int64_t r = 0; r < rounds; r++) {
+        memcpy(p, data[0], B);
+        for (int i = 1; i < n; i++) {
+            xor_into(p, data[i], B);
+        }
+    }
+    *pRate = (double)rounds * n * B / (now() - start) / 1e9;
+    start = now();
+    for (int64_t r = 0; r < rounds; r++) {
+        gf256_gen_pq(data, n, p, q, B);
+    }
+    *pqRate = (double)rounds * n * B / (now() - start) / 1e9;
+    free(buf);
+    return 0;
+}
+
+// encode then read back the whole volume, reporting GB/s for each
+static int runCase(const raid5_geom_t *g, const char *inputPath, char **paths, int threads,
+                   double *encodeRate, double *readRate) {
+    int64_t J = raid5_capacity(g);
+    disk_t disks[RAID5_MAX_DISKS];
+    FILE *fin = fopen(inputPath, "rb");
+    if (!fin) return -1;
+    for (int d = 0; d < g->N; d++) {
+        if (disk_create(&disks[d], paths[d], 0, g->K) != 0) {
+            perror(paths[d]);
+            fclose(fin);
+            return -1;
+        }
+    }
+    double start = now();
+    int status = raid5_encode(g, disks, fin, 0, J, threads);
+    *encodeRate = J / (now() - start) / 1e9;
+    fclose(fin);
+
+    unsigned char *buf = malloc(READ_STEP);
+    start = now();
+    for (int64_t off = 0; status == 0 && buf && off < J; off += READ_STEP) {
+        status = raid5_read(g, disks, -1, buf, J - off < READ_STEP ? J - off : READ_STEP, off);
+    }
+    *readRate = J / (now() - start) / 1e9;
+    free(buf);
+    for (int d = 0; d < g->N; d++) {
+        disk_close(&disks[d]);
+    }
+    return buf ? status : -1;
+}
+
+static const int queueDepths[] = {1, 2, 4, 8, 16, 32};
+#define NUM_DEPTHS (int)(sizeof(queueDepths) / sizeof(queueDepths[0]))
+
+// scrub rate of one encoded array for every queue depth; direct bypasses the page cache
+static int depthSweep(const raid5_geom_t *g, const char *inputPath, char **paths, int threads, int direct) {
+    double encodeRate, readRate;
+    if (runCase(g, inputPath, paths, threads, &encodeRate, &readRate) != 0) return -1;
+    printf("\n%-8s %-10s %12s\n", "depth", "backend", "scrub GB/s");
+    for (int q = 0; q < NUM_DEPTHS; q++) {
+        disk_t disks[RAID5_MAX_DISKS];
+        int status = 0, opened = 0;
+        io_set_depth(queueDepths[q]);
+        for (; opened < g->N && status == 0; opened++) {
+            status = disk_open(&disks[opened], paths[opened], 0, O_RDONLY);
+            if (status == 0 && direct) status = disk_open_direct(&disks[opened]);
+            if (status != 0) perror(paths[opened]);
+        }
+        io_t *io = io_open(g->N); // only to learn which backend this depth gets
+        const char *backend = io ? io_backend_name(io_backend(io)) : "?";
+        io_close(io);
+
+        raid5_scrub_stats_t stats;
+        double start = now();
+        if (status == 0) status = raid5_scrub(g, disks, 0, NULL, threads, stdout, &stats);
+        double rate = (double)g->N * g->K / (now() - start) / 1e9;
+        for (int d = 0; d < opened; d++) {
+            disk_close(&disks[d]);
+        }
+        if (status != 0) return -1;
+        printf("%-8d %-10s %12.2f\n", queueDepths[q], backend, rate);
+        fflush(stdout);
+    }
+    io_set_depth(1);
+    return 0;
+}
+
+static int openAll(const raid5_geom_t *g, char **paths, disk_t *disks, int direct) {
+    for (int d = 0; d < g->N; d++) {
+        if (disk_open(&disks[d], paths[d], 0, O_RDWR) != 0 || (direct && disk_open_direct(&disks[d]) != 0)) {
+            perror(paths[d]);
+            while (d >= 0) disk_close(&disks[d--]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// encode and read rates are logical bytes per second; rebuild counts the
+// survivors read and scrub every member, so all four compare disk traffic
+static int measureAll(const raid5_geom_t *g, const char *inputPath, char **paths, int threads, int direct,
+                      double rates[4]) {
+    if (runCase(g, inputPath, paths, threads, &rates[0], &rates[1]) != 0) return -1;
+
+    disk_t disks[RAID5_MAX_DISKS];
+    if (openAll(g, paths, disks, direct) != 0) return -1;
+    disk_close(&disks[0]);
+    int status = disk_create(&disks[0], paths[0], 0, g->K);
+    double start = now();
+    if (status == 0) status = raid5_rebuild(g, disks, 0, threads);
+    rates[2] = (double)(g->N - 1) * g->K / (now() - start) / 1e9;
+
+    raid5_scrub_stats_t stats;
+    start = now();
+    if (status == 0) status = raid5_scrub(g, disks, 0, NULL, threads, stderr, &stats);
+    rates[3] = (double)g->N * g->K / (now() - start) / 1e9;
+    if (status == 0 && stats.badStripes != 0) status = -1; // a rebuild that broke parity is not a result
+    for (int d = 0; d < g->N; d++) {
+        disk_close(&disks[d]);
+    }
+    return status;
+}
+
+static const int jsonDisks[] = {3, 5, 8};
+#define NUM_JSON_DISKS (int)(sizeof(jsonDisks) / sizeof(jsonDisks[0]))
+
+// one JSON document covering every disk count and chunk size, for tracking across builds
+static int jsonReport(const char *inputPath, char **paths, int64_t size, int threads, int direct) {
+    printf("{\n  \"size_mib\": %lld,\n  \"threads\": %d,\n  \"queue_depth\": %d,\n  \"direct\": %s,\n",
+           (long long)(size >> 20), threads, io_get_depth(), direct ? "true" : "false");
+    printf("  \"results\": [");
+    const char *sep = "\n";
+    for (int n = 0; n < NUM_JSON_DISKS; n++) {
+        for (int c = 0; c < NUM_CHUNKS; c++) {
+            raid5_geom_t g;
+            g.B = chunkSizes[c];
+            g.N = jsonDisks[n];
+            g.K = caseDiskSize(size, g.N, g.B);
+            g.layout = RAID5_LEFT_SYMMETRIC;
+            double rates[4];
+            if (raid5_geom_init(&g) != 0 || measureAll(&g, inputPath, paths, threads, direct, rates) != 0) {
+                fprintf(stderr, "%d disks with %lld byte chunks failed\n", g.N, (long long)g.B);
+                printf("\n  ]\n}\n"); // keep what was measured valid JSON
+                return -1;
+            }
+            printf("%s    {\"B\": %lld, \"N\": %d, \"K\": %lld, \"encode_gbps\": %.3f, \"decode_gbps\": %.3f, "
+                   "\"rebuild_gbps\": %.3f, \"scrub_gbps\": %.3f}", sep, (long long)g.B, g.N, (long long)g.K,
+                   rates[0], rates[1], rates[2], rates[3]);
+            sep = ",\n";
+        }
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = "/tmp";
+    int64_t size = 256 << 20; // logical bytes per case
+    int N = 5, threads = 1, direct = 0, json = 0, opt;
+    while ((opt = getopt(argc, argv, "d:s:n:t:q:Dj")) != -1) {
+        if (opt == 'd') dir = optarg;
+        else if (opt == 's') size = (int64_t)atoi(optarg) << 20;
+        else if (opt == 'n') N = atoi(optarg);
+        else if (opt == 't') threads = atoi(optarg);
+        else if (opt == 'q') io_set_depth(atoi(optarg));
+        else if (opt == 'D') direct = 1;
+        else if (opt == 'j') json = 1;
+        else {
+            fprintf(stderr, "Usage: %s [-d dir] [-s MiB] [-n disks] [-t threads] [-q depth] [-D] [-j]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (N < 2 || N > RAID5_MAX_DISKS || size < 1 || threads < 1) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (json) N = jsonDisks[NUM_JSON_DISKS - 1]; // paths and input for the widest array
+
+    char inputPath[4096], pathBufs[RAID5_MAX_DISKS][4096], *paths[RAID5_MAX_DISKS];
+    snprintf(inputPath, sizeof(inputPath), "%s/raid5-bench-input", dir);
+    for (int d = 0; d < N; d++) {
+        snprintf(pathBufs[d], sizeof(pathBufs[d]), "%s/raid5-bench-disk%d", dir, d);
+        paths[d] = pathBufs[d];
+    }
+
+    int64_t inputBytes = json ? inputSize(size, jsonDisks, NUM_JSON_DISKS) : inputSize(size, &N, 1);
+    if (makeInput(inputPath, inputBytes) != 0) {
+        perror(inputPath);
+        return EXIT_FAILURE;
+    }
+
+    if (json) {
+        int status = jsonReport(inputPath, paths, size, threads, direct) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        unlink(inputPath);
+        for (int d = 0; d < N; d++) {
+            unlink(paths[d]);
+        }
+        return status;
+    }
+
+    int status = EXIT_SUCCESS;
+    printf("%-18s %10s %12s %12s\n", "layout", "chunk", "encode GB/s", "read GB/s");
+    for (int layout = 0; layout < RAID5_NUM_LAYOUTS && status == EXIT_SUCCESS; layout++) {
+        for (int c = 0; c < NUM_CHUNKS; c++) {
+            raid5_geom_t g;
+            g.B = chunkSizes[c];
+            g.N = N;
+            g.K = caseDiskSize(size, N, g.B);
+            g.layout = layout;
+            double encodeRate, readRate;
+            if (raid5_geom_init(&g) != 0 || runCase(&g, inputPath, paths, threads, &encodeRate, &readRate) != 0) {
+                fprintf(stderr, "%s with %lld byte chunks failed\n", raid5_layout_name(layout), (long long)g.B);
+                status = EXIT_FAILURE;
+                break;
+            }
+            printf("%-18s %10lld %12.2f %12.2f\n", raid5_layout_name(layout), (long long)g.B, encodeRate, readRate);
+            fflush(stdout);
+        }
+    }
+
+    if (status == EXIT_SUCCESS) { // queue depth only matters once requests reach the device
+        raid5_geom_t g;
+        g.B = 1 << 20;
+        g.N = N;
+        g.K = caseDiskSize(size, N, g.B); // 1 MiB is one of chunkSizes, so the input covers it
+        g.layout = RAID5_LEFT_SYMMETRIC;
+        if (raid5_geom_init(&g) != 0 || depthSweep(&g, inputPath, paths, threads, direct) != 0) {
+            fprintf(stderr, "queue depth sweep failed\n");
+            status = EXIT_FAILURE;
+        }
+    }
+
+    double pRate, pqRate;
+    if (status == EXIT_SUCCESS && kernelRates(N, &pRate, &pqRate) == 0) {
+        printf("\nparity kernels, %d data blocks: P %.2f GB/s, P+Q %.2f GB/s (%.0f%%)\n",
+               N - 2 > 0 ? N - 2 : 1, pRate, pqRate, 100.0 * pqRate / pRate);
+    }
+
+    unlink(inputPath);
+    for (int d = 0; d < N; d++) {
+        unlink(paths[d]);
+    }
+    return status;
+}
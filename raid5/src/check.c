@@ -0,0 +1,426 @@
+#define _GNU_SOURCE // mkdtemp and getopt under -std=c99
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "raid5.h"
+
+// correctness harness: random geometries checked against a byte-at-a-time
+// reference encoder that shares no code with the library
+
+#define MAX_N 8 // disks per case; one more is added by the reshape check
+
+typedef struct {
+    raid5_geom_t g;
+    int hex, threads;
+    char dir[64];
+    char pathBufs[MAX_N + 1][96], *paths[MAX_N + 1];
+    disk_t disks[MAX_N + 1];
+} case_t;
+
+static uint64_t rngState;
+static int failures;
+
+static uint64_t next(void) { // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545f4914f6cdd1dULL;
+}
+
+static int64_t below(int64_t n) {
+    return (int64_t)(next() % (uint64_t)n);
+}
+
+static void fail(const case_t *c, const char *what) {
+    fprintf(stderr, "FAIL %s: B=%" PRId64 " K=%" PRId64 " N=%d layout=%s %s threads=%d depth=%d\n", what, c->g.B,
+            c->g.K, c->g.N, raid5_layout_name(c->g.layout), c->hex ? "hex" : "binary", c->threads, io_get_depth());
+    failures++;
+}
+
+// ---- reference placement and parity, straight from the definitions ----
+
+static void refPlace(int layout, int N, int64_t stripe, int *parity, int *disks) {
+    int s = (int)(stripe % N);
+    int p = layout == RAID5_RAID4 ? N - 1
+          : layout == RAID5_LEFT_SYMMETRIC || layout == RAID5_LEFT_ASYMMETRIC ? N - 1 - s : s;
+    *parity = p;
+    for (int i = 0; i < N - 1; i++) {
+        int symmetric = layout == RAID5_LEFT_SYMMETRIC || layout == RAID5_RIGHT_SYMMETRIC;
+        disks[i] = symmetric ? (p + 1 + i) % N : i < p ? i : i + 1;
+    }
+}
+
+// images[d] gets K bytes for every disk; data is len bytes of the logical volume
+static void refEncode(const raid5_geom_t *g, const unsigned char *data, int64_t len, unsigned char **images) {
+    int N = g->N;
+    for (int d = 0; d < N; d++) {
+        memset(images[d], 0, g->K);
+    }
+    for (int64_t block = 0; block * g->B < len; block++) {
+        int64_t stripe = block / (N - 1);
+        int parity, disks[MAX_N + 1];
+        refPlace(g->layout, N, stripe, &parity, disks);
+        int d = disks[block % (N - 1)];
+        for (int64_t b = 0; b < g->B; b++) {
+            unsigned char v = data[block * g->B + b];
+            images[d][stripe * g->B + b] = v;
+            images[parity][stripe * g->B + b] ^= v;
+        }
+    }
+}
+
+static unsigned char gfMul(unsigned char a, unsigned char b) { // shift and add, polynomial 0x11d
+    unsigned char r = 0;
+    while (b) {
+        if (b & 1) r ^= a;
+        a = (unsigned char)((a << 1) ^ (a & 0x80 ? 0x1d : 0));
+        b >>= 1;
+    }
+    return r;
+}
+
+static void refEncode6(const raid5_geom_t *g, const unsigned char *data, int64_t len, unsigned char **images) {
+    int N = g->N;
+    for (int d = 0; d < N; d++) {
+        memset(images[d], 0, g->K);
+    }
+    for (int64_t block = 0; block * g->B < len; block++) {
+        int64_t stripe = block / (N - 2);
+        int i = (int)(block % (N - 2));
+        int p = N - 1 - (int)(stripe % N), q = (p + 1) % N, d = (p + 2 + i) % N;
+        unsigned char coef = 1;
+        for (int k = 0; k < i; k++) {
+            coef = gfMul(coef, 2);
+        }
+        for (int64_t b = 0; b < g->B; b++) {
+            unsigned char v = data[block * g->B + b];
+            images[d][stripe * g->B + b] = v;
+            images[p][stripe * g->B + b] ^= v;
+            images[q][stripe * g->B + b] ^= gfMul(coef, v);
+        }
+    }
+}
+
+// ---- helpers ----
+
+static unsigned char **allocImages(int N, int64_t K) {
+    unsigned char **images = calloc(N, sizeof(unsigned char *));
+    for (int d = 0; d < N; d++) {
+        images[d] = malloc(K);
+    }
+    return images;
+}
+
+static void freeImages(unsigned char **images, int N) {
+    for (int d = 0; d < N; d++) {
+        free(images[d]);
+    }
+    free(images);
+}
+
+static void randomBytes(unsigned char *buf, int64_t len) {
+    int zeros = below(4) == 0; // some inputs with long zero runs to exercise holes
+    for (int64_t i = 0; i < len; i++) {
+        buf[i] = zeros && (i / 64) % 3 == 0 ? 0 : (unsigned char)next();
+    }
+}
+
+// input file in the format the case uses
+static FILE *writeInput(const case_t *c, const unsigned char *data, int64_t len) {
+    FILE *f = tmpfile();
+    if (!f) return NULL;
+    if (c->hex) {
+        char *hex = malloc(2 * len);
+        hex_encode(data, len, hex);
+        fwrite(hex, 1, 2 * len, f);
+        free(hex);
+    } else {
+        fwrite(data, 1, len, f);
+    }
+    rewind(f);
+    return f;
+}
+
+static int createDisks(case_t *c, int N) {
+    for (int d = 0; d < N; d++) {
+        if (disk_create(&c->disks[d], c->paths[d], c->hex, c->g.K) != 0) return -1;
+    }
+    return 0;
+}
+
+static void closeDisks(case_t *c, int N) {
+    for (int d = 0; d < N; d++) {
+        disk_close(&c->disks[d]);
+    }
+}
+
+// compare what is on disk with the reference images
+static int sameImages(case_t *c, unsigned char **images, int N) {
+    unsigned char *buf = malloc(c->g.K);
+    int same = 1;
+    for (int d = 0; d < N && same; d++) {
+        same = disk_read(&c->disks[d], buf, c->g.K, 0) == 0 && memcmp(buf, images[d], c->g.K) == 0;
+    }
+    free(buf);
+    return same;
+}
+
+static int encodeCase(case_t *c, const unsigned char *data, int64_t len, int raid6) {
+    FILE *f = writeInput(c, data, len);
+    if (!f || createDisks(c, c->g.N) != 0) {
+        if (f) fclose(f);
+        return -1;
+    }
+    int status = raid6 ? raid6_encode(&c->g, c->disks, f, c->hex, len, c->threads)
+                       : raid5_encode(&c->g, c->disks, f, c->hex, len, c->threads);
+    fclose(f);
+    return status;
+}
+
+// ---- the checks ----
+
+// encode, read back (degraded too), rebuild, update and scrub one RAID-5 array
+static void checkRaid5(case_t *c) {
+    raid5_geom_t *g = &c->g;
+    int N = g->N;
+    int64_t cap = raid5_capacity(g);
+    int64_t J = g->B * (1 + below(cap / g->B));
+    unsigned char *model = calloc(cap, 1), *buf = malloc(cap);
+    unsigned char **images = allocImages(N, g->K);
+    randomBytes(model, J);
+
+    refEncode(g, model, J, images);
+    if (encodeCase(c, model, J, 0) != 0 || !sameImages(c, images, N)) fail(c, "encode");
+
+    for (int i = 0; i < 4; i++) {
+        int64_t off = below(cap), len = 1 + below(cap - off);
+        int missing = below(2) ? (int)below(N) : -1;
+        if (raid5_read(g, c->disks, missing, buf, len, off) != 0 || memcmp(buf, model + off, len) != 0) {
+            fail(c, missing < 0 ? "read" : "degraded read");
+            break;
+        }
+    }
+
+    int lost = (int)below(N);
+    disk_close(&c->disks[lost]);
+    if (disk_create(&c->disks[lost], c->paths[lost], c->hex, g->K) != 0
+     || raid5_rebuild(g, c->disks, lost, c->threads) != 0 || !sameImages(c, images, N)) {
+        fail(c, "rebuild");
+    }
+
+    for (int i = 0; i < 3; i++) {
+        int64_t off = below(cap), len = 1 + below(below(2) ? cap - off : (g->B * 2 < cap - off ? g->B * 2 : cap - off));
+        randomBytes(model + off, len);
+        if (raid5_update(g, c->disks, model + off, len, off) != 0) {
+            fail(c, "update");
+            break;
+        }
+    }
+    refEncode(g, model, cap, images);
+    if (!sameImages(c, images, N)) fail(c, "update");
+
+    FILE *report = tmpfile();
+    raid5_scrub_stats_t stats;
+    char sidecar[128];
+    snprintf(sidecar, sizeof(sidecar), "%s/crc", c->dir);
+    if (raid5_checksum(g, c->disks, sidecar, c->threads) != 0
+     || raid5_scrub(g, c->disks, 0, sidecar, c->threads, report, &stats) != 0
+     || stats.stripes != g->K / g->B || stats.badStripes != 0 || stats.badBlocks != 0) {
+        fail(c, "clean scrub");
+    } else { // flip one byte: one bad stripe, and the checksum names that disk
+        int d = (int)below(N);
+        int64_t off = below(g->K);
+        unsigned char byte;
+        disk_read(&c->disks[d], &byte, 1, off);
+        byte ^= 0x5a;
+        disk_write(&c->disks[d], &byte, 1, off);
+        if (raid5_scrub(g, c->disks, 0, sidecar, c->threads, report, &stats) != 0
+         || stats.badStripes != 1 || stats.badBlocks != 1) {
+            fail(c, "scrub of a corrupt block");
+        }
+    }
+    fclose(report);
+    unlink(sidecar);
+    closeDisks(c, N);
+    freeImages(images, N);
+    free(model);
+    free(buf);
+}
+
+// random reads and writes through the cached handle against a flat model
+static void checkHandle(case_t *c) {
+    raid5_geom_t *g = &c->g;
+    int N = g->N;
+    int64_t cap = raid5_capacity(g);
+    unsigned char *model = calloc(cap, 1), *buf = malloc(cap);
+    unsigned char **images = allocImages(N, g->K);
+    refEncode(g, model, 0, images);
+    if (createDisks(c, N) != 0) fail(c, "create");
+    closeDisks(c, N);
+    if (c->hex) { // hex images are only full size once written
+        for (int d = 0; d < N; d++) {
+            disk_open(&c->disks[d], c->paths[d], 1, O_RDWR);
+            disk_write_zeros(&c->disks[d], 0, g->K);
+            disk_close(&c->disks[d]);
+        }
+    }
+
+    raid5_t *r = raid5_open(g, c->paths, c->hex, 1 + (int)below(8));
+    for (int op = 0; r && op < 200; op++) {
+        int64_t off = below(cap), len = 1 + below(below(2) ? g->B * 2 : cap);
+        if (len > cap - off) len = cap - off;
+        if (below(2)) {
+            randomBytes(model + off, len);
+            if (raid5_pwrite(r, model + off, len, off) != 0) break;
+        } else if (raid5_pread(r, buf, len, off) != 0 || memcmp(buf, model + off, len) != 0) {
+            fail(c, "handle read");
+            break;
+        }
+        if (below(40) == 0) raid5_flush(r);
+    }
+    if (!r || raid5_close(r) != 0) fail(c, "handle");
+
+    refEncode(g, model, cap, images);
+    for (int d = 0; d < N; d++) {
+        disk_open(&c->disks[d], c->paths[d], c->hex, O_RDONLY);
+    }
+    if (!sameImages(c, images, N)) fail(c, "handle write-back");
+    closeDisks(c, N);
+    freeImages(images, N);
+    free(model);
+    free(buf);
+}
+
+// grow by one disk and compare with a fresh encode of the same volume
+static void checkReshape(case_t *c) {
+    raid5_geom_t *g = &c->g;
+    int N = g->N;
+    int64_t cap = raid5_capacity(g);
+    unsigned char *model = calloc(cap, 1);
+    int64_t J = g->B * (1 + below(cap / g->B));
+    randomBytes(model, J);
+
+    char checkpoint[128];
+    snprintf(checkpoint, sizeof(checkpoint), "%s/checkpoint", c->dir);
+    if (encodeCase(c, model, J, 0) != 0) fail(c, "encode before reshape");
+    c->disks[N].fd = -1;
+    c->disks[N].path = c->paths[N];
+    c->disks[N].hex = c->hex;
+    raid5_geom_t grown = *g;
+    grown.N = N + 1;
+    unsigned char **images = allocImages(N + 1, g->K);
+    if (raid5_geom_init(&grown) != 0 || raid5_reshape(g, c->disks, checkpoint) != 0) {
+        fail(c, "reshape");
+    } else {
+        refEncode(&grown, model, cap, images);
+        if (!sameImages(c, images, N + 1) || access(checkpoint, F_OK) == 0) fail(c, "reshape");
+    }
+    closeDisks(c, N + 1);
+    freeImages(images, N + 1);
+    free(model);
+}
+
+// P and Q against the reference, then every kind of double failure
+static void checkRaid6(case_t *c) {
+    raid5_geom_t *g = &c->g;
+    int N = g->N;
+    int64_t cap = g->K / g->B * (N - 2) * g->B;
+    int64_t J = g->B * (1 + below(cap / g->B));
+    unsigned char *model = calloc(cap, 1);
+    unsigned char **images = allocImages(N, g->K);
+    randomBytes(model, J);
+    refEncode6(g, model, J, images);
+    if (encodeCase(c, model, J, 1) != 0 || !sameImages(c, images, N)) fail(c, "raid6 encode");
+
+    for (int i = 0; i < 3; i++) {
+        int missing[2] = {(int)below(N), (int)below(N)};
+        int count = missing[0] == missing[1] ? 1 : 2;
+        for (int k = 0; k < count; k++) {
+            disk_close(&c->disks[missing[k]]);
+            disk_create(&c->disks[missing[k]], c->paths[missing[k]], c->hex, g->K);
+        }
+        if (raid6_rebuild(g, c->disks, missing, count, c->threads) != 0 || !sameImages(c, images, N)) {
+            fail(c, "raid6 rebuild");
+            break;
+        }
+    }
+
+    FILE *report = tmpfile();
+    raid5_scrub_stats_t stats;
+    if (raid5_scrub(g, c->disks, 1, NULL, c->threads, report, &stats) != 0 || stats.badStripes != 0) {
+        fail(c, "raid6 scrub");
+    }
+    fclose(report);
+    closeDisks(c, N);
+    freeImages(images, N);
+    free(model);
+}
+
+// pick a random geometry small enough to check byte by byte
+static void randomCase(case_t *c, int minN) {
+    static const int64_t blockSizes[] = {1, 3, 16, 100, 512, 4096, 65536};
+    int numSizes = (int)(sizeof(blockSizes) / sizeof(blockSizes[0]));
+    c->g.B = blockSizes[below(numSizes)];
+    c->g.N = minN + (int)below(MAX_N - minN + 1);
+    int64_t maxStripes = c->g.B >= 4096 ? 24 : 200;
+    c->g.K = c->g.B * (1 + below(maxStripes));
+    c->g.layout = (int)below(RAID5_NUM_LAYOUTS);
+    c->hex = (int)below(2);
+    c->threads = 1 + (int)below(3);
+    io_set_depth(below(2) ? 1 : 1 << below(5));
+    raid5_geom_init(&c->g);
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = 40, opt;
+    uint64_t seed = 1;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        if (opt == 'n') iterations = atoi(optarg);
+        else if (opt == 's') seed = strtoull(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: %s [-n iterations] [-s seed]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    rngState = seed * 0x9e3779b97f4a7c15ULL + 1;
+
+    case_t c;
+    snprintf(c.dir, sizeof(c.dir), "/tmp/raid5-check-XXXXXX");
+    if (!mkdtemp(c.dir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    for (int d = 0; d <= MAX_N; d++) {
+        snprintf(c.pathBufs[d], sizeof(c.pathBufs[d]), "%s/disk%d", c.dir, d);
+        c.paths[d] = c.pathBufs[d];
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        randomCase(&c, 2);
+        checkRaid5(&c);
+        randomCase(&c, 2);
+        checkHandle(&c);
+        randomCase(&c, 2);
+        if (c.g.N == MAX_N) c.g.N--; // leave room for the new disk
+        raid5_geom_init(&c.g);
+        checkReshape(&c);
+        randomCase(&c, 3);
+        checkRaid6(&c);
+    }
+
+    for (int d = 0; d <= MAX_N; d++) {
+        unlink(c.paths[d]);
+    }
+    rmdir(c.dir);
+    if (failures) {
+        fprintf(stderr, "%d checks failed (seed %" PRIu64 ")\n", failures, seed);
+        return EXIT_FAILURE;
+    }
+    printf("%d iterations passed (seed %" PRIu64 ")\n", iterations, seed);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "crc32c.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define POLY 0x82f63b78u // reflected Castagnoli polynomial
+
+static uint32_t table[256];
+static pthread_once_t tableOnce = PTHREAD_ONCE_INIT;
+
+static void buildTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? (c >> 1) ^ POLY : c >> 1;
+        }
+        table[i] = c;
+    }
+}
+
+static uint32_t crcTable(uint32_t crc, const unsigned char *p, size_t len) {
+    pthread_once(&tableOnce, buildTable);
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crcHardware(uint32_t crc, const unsigned char *p, size_t len) {
+    uint64_t c = crc;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, sizeof(word)); // unaligned-safe load
+        c = _mm_crc32_u64(c, word);
+    }
+    uint32_t c32 = (uint32_t)c;
+    for (; i < len; i++) {
+        c32 = _mm_crc32_u8(c32, p[i]);
+    }
+    return c32;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len) {
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) return ~crcHardware(crc, buf, len);
+#endif
+    return ~crcTable(crc, buf, len);
+}
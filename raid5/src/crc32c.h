@@ -0,0 +1,11 @@
+#ifndef __CRC32C_HEADER__
+#define __CRC32C_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32C (Castagnoli) of len bytes, continuing from crc; start a new checksum with 0.
+// Uses the SSE4.2 crc32 instruction when the CPU has it, a lookup table otherwise.
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len);
+
+#endif
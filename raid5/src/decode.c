@@ -0,0 +1,90 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io.h"
+#include "raid5.h"
+#include "xor.h"
+
+#define READ_WINDOW (1 << 20) // bytes per disk read in one batch
+
+int raid5_read(const raid5_geom_t *g, disk_t *disks, int missing, unsigned char *buf, int64_t len, int64_t off) {
+    if (len == 0) return 0;
+    if (off < 0 || len < 0 || off + len > raid5_capacity(g)) {
+        errno = EINVAL;
+        return -1;
+    }
+    int N = g->N, perStripe = N - 1;
+    int64_t B = g->B;
+    int64_t firstBlock = off / B, lastBlock = (off + len - 1) / B; // logical blocks touched
+    int64_t firstStripe = firstBlock / perStripe, lastStripe = lastBlock / perStripe;
+    int64_t window = READ_WINDOW / B; // stripes per batch
+    if (window < 1) window = 1;
+    if (window > lastStripe - firstStripe + 1) window = lastStripe - firstStripe + 1;
+
+    unsigned char *bufs = io_alloc((size_t)(N * window * B)); // one region per disk
+    unsigned char *rebuilt = malloc((size_t)B);
+    int64_t *lo = malloc(N * sizeof(int64_t)), *hi = malloc(N * sizeof(int64_t));
+    io_t *io = io_open(N);
+    int status = bufs && rebuilt && lo && hi && io ? 0 : -1;
+
+    for (int64_t ws = firstStripe; status == 0 && ws <= lastStripe; ws += window) {
+        int64_t count = lastStripe - ws + 1 < window ? lastStripe - ws + 1 : window; // stripes in this batch
+
+        // find the stripe range each disk must supply for this batch
+        for (int d = 0; d < N; d++) {
+            lo[d] = INT64_MAX;
+            hi[d] = -1;
+        }
+        for (int64_t s = ws; s < ws + count; s++) {
+            for (int i = 0; i < perStripe; i++) {
+                int64_t block = s * perStripe + i;
+                if (block < firstBlock || block > lastBlock) continue;
+                int disk = raid5_data_disk(g, s, i);
+                for (int d = 0; d < N; d++) { // a lost block needs every survivor, parity included
+                    if (d == missing || (disk != missing && d != disk)) continue;
+                    if (s < lo[d]) lo[d] = s;
+                    if (s > hi[d]) hi[d] = s;
+                }
+            }
+        }
+
+        // one sequential read per disk, all of them in flight together
+        for (int d = 0; d < N && status == 0; d++) {
+            if (hi[d] < 0) continue;
+            unsigned char *region = bufs + (d * window + lo[d] - ws) * B;
+            status = disk_queue_read(io, &disks[d], region, (hi[d] - lo[d] + 1) * B, lo[d] * B);
+        }
+        if (io_wait(io) != 0 || status != 0) {
+            perror("Failed to read the array");
+            status = -1;
+        }
+
+        // scatter the requested bytes, recomputing blocks of the missing disk
+        for (int64_t s = ws; status == 0 && s < ws + count; s++) {
+            for (int i = 0; i < perStripe; i++) {
+                int64_t block = s * perStripe + i;
+                if (block < firstBlock || block > lastBlock) continue;
+                int disk = raid5_data_disk(g, s, i);
+                const unsigned char *src = bufs + (disk * window + s - ws) * B;
+                if (disk == missing) {
+                    memset(rebuilt, 0, B);
+                    for (int d = 0; d < N; d++) {
+                        if (d != missing) xor_into(rebuilt, bufs + (d * window + s - ws) * B, B);
+                    }
+                    src = rebuilt;
+                }
+                int64_t start = block * B < off ? off - block * B : 0; // clip to the request
+                int64_t end = (block + 1) * B > off + len ? off + len - block * B : B;
+                memcpy(buf + block * B + start - off, src + start, end - start);
+            }
+        }
+    }
+    io_close(io);
+    free(bufs);
+    free(rebuilt);
+    free(lo);
+    free(hi);
+    return status;
+}
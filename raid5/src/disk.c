@@ -0,0 +1,184 @@
+#define _GNU_SOURCE // pread/pwrite/fallocate under -std=c99
+#define _FILE_OFFSET_BITS 64
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "disk.h"
+
+#define HEX_STEP (1 << 15) // bytes converted per hex read or write
+#define DIRECT_ALIGN 4096 // buffer, offset and length alignment O_DIRECT needs
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int full_pread(int fd, void *buf, int64_t len, int64_t off) {
+    for (int64_t done = 0; done < len; ) {
+        ssize_t n = pread(fd, (char *)buf + done, len - done, off + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO; // file shorter than the caller expects
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+int full_pwrite(int fd, const void *buf, int64_t len, int64_t off) {
+    for (int64_t done = 0; done < len; ) {
+        ssize_t n = pwrite(fd, (const char *)buf + done, len - done, off + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+int disk_open(disk_t *d, const char *path, int hex, int flags) {
+    d->path = path;
+    d->hex = hex;
+    d->dfd = -1;
+    d->fd = open(path, flags, 0644);
+    return d->fd < 0 ? -1 : 0;
+}
+
+int disk_open_direct(disk_t *d) {
+    if (d->hex) { // text images are never transferred as-is
+        errno = EINVAL;
+        return -1;
+    }
+    int flags = fcntl(d->fd, F_GETFL);
+    if (flags < 0) return -1;
+    d->dfd = open(d->path, (flags & O_ACCMODE) | O_DIRECT);
+    return d->dfd < 0 ? -1 : 0;
+}
+
+int disk_create(disk_t *d, const char *path, int hex, int64_t K) {
+    if (disk_open(d, path, hex, O_RDWR | O_CREAT | O_TRUNC) != 0) return -1;
+    if (!hex && ftruncate(d->fd, K) != 0) { // unwritten regions stay holes
+        disk_close(d);
+        return -1;
+    }
+    return 0;
+}
+
+void disk_close(disk_t *d) {
+    if (d->fd >= 0) {
+        close(d->fd);
+        if (d->dfd >= 0) close(d->dfd); // only meaningful while fd is open
+    }
+    d->fd = -1;
+    d->dfd = -1;
+}
+
+int64_t disk_size(disk_t *d) {
+    struct stat st;
+    if (fstat(d->fd, &st) != 0) return -1;
+    return d->hex ? st.st_size / 2 : st.st_size;
+}
+
+int disk_read(disk_t *d, unsigned char *buf, int64_t len, int64_t off) {
+    if (!d->hex) return full_pread(d->fd, buf, len, off);
+    char hex[2 * HEX_STEP];
+    for (int64_t done = 0; done < len; done += HEX_STEP) {
+        int64_t n = len - done < HEX_STEP ? len - done : HEX_STEP;
+        if (full_pread(d->fd, hex, 2 * n, 2 * (off + done)) != 0) return -1;
+        if (hex_decode(hex, buf + done, n) >= 0) {
+            errno = EILSEQ;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int disk_write(disk_t *d, const unsigned char *buf, int64_t len, int64_t off) {
+    if (!d->hex) return full_pwrite(d->fd, buf, len, off);
+    char hex[2 * HEX_STEP];
+    for (int64_t done = 0; done < len; done += HEX_STEP) {
+        int64_t n = len - done < HEX_STEP ? len - done : HEX_STEP;
+        hex_encode(buf + done, n, hex);
+        if (full_pwrite(d->fd, hex, 2 * n, 2 * (off + done)) != 0) return -1;
+    }
+    return 0;
+}
+
+int disk_write_sparse(disk_t *d, const unsigned char *buf, int64_t len, int64_t off, int64_t B) {
+    if (d->hex) return disk_write(d, buf, len, off); // hex text has no holes
+    int64_t runStart = -1; // start of the current run of non-zero blocks
+    for (int64_t pos = 0; ; pos += B) {
+        int end = pos >= len;
+        int zero = end || is_zero(buf + pos, len - pos < B ? len - pos : B);
+        if (!zero && runStart < 0) runStart = pos;
+        if (zero && runStart >= 0) { // flush the run as a single write
+            int64_t stop = end ? len : pos;
+            if (full_pwrite(d->fd, buf + runStart, stop - runStart, off + runStart) != 0) return -1;
+            runStart = -1;
+        }
+        if (end) break;
+    }
+    return 0;
+}
+
+int disk_write_zeros(disk_t *d, int64_t off, int64_t len) {
+    if (len <= 0) return 0;
+#ifdef FALLOC_FL_PUNCH_HOLE
+    if (!d->hex && fallocate(d->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off, len) == 0) return 0;
+#endif
+    static const unsigned char zeros[HEX_STEP];
+    for (int64_t done = 0; done < len; done += HEX_STEP) {
+        int64_t n = len - done < HEX_STEP ? len - done : HEX_STEP;
+        if (disk_write(d, zeros, n, off + done) != 0) return -1;
+    }
+    return 0;
+}
+
+// the descriptor to use for a transfer: O_DIRECT when everything lines up
+static int pickFd(const disk_t *d, const void *buf, int64_t len, int64_t off) {
+    int aligned = (uintptr_t)buf % DIRECT_ALIGN == 0 && len % DIRECT_ALIGN == 0 && off % DIRECT_ALIGN == 0;
+    return d->dfd >= 0 && aligned ? d->dfd : d->fd;
+}
+
+int disk_queue_read(io_t *io, disk_t *d, unsigned char *buf, int64_t len, int64_t off) {
+    if (d->hex) return disk_read(d, buf, len, off);
+    return io_read(io, pickFd(d, buf, len, off), buf, len, off);
+}
+
+int disk_queue_write(io_t *io, disk_t *d, const unsigned char *buf, int64_t len, int64_t off) {
+    if (d->hex) return disk_write(d, buf, len, off);
+    return io_write(io, pickFd(d, buf, len, off), buf, len, off);
+}
+
+int disk_sync(disk_t *d) {
+    return fdatasync(d->fd);
+}
+
+int is_zero(const unsigned char *buf, int64_t len) {
+    return len == 0 || (buf[0] == 0 && memcmp(buf, buf + 1, len - 1) == 0);
+}
+
+void hex_encode(const unsigned char *buf, int64_t len, char *hex) {
+    for (int64_t i = 0; i < len; i++) {
+        hex[2 * i] = hexDigits[buf[i] >> 4];
+        hex[2 * i + 1] = hexDigits[buf[i] & 0x0f];
+    }
+}
+
+int64_t hex_decode(const char *hex, unsigned char *buf, int64_t len) {
+    for (int64_t i = 0; i < len; i++) {
+        int hi = hexValue(hex[2 * i]), lo = hexValue(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return i;
+        buf[i] = (unsigned char)(hi << 4 | lo);
+    }
+    return -1;
+}
@@ -0,0 +1,44 @@
+#ifndef __DISK_HEADER__
+#define __DISK_HEADER__
+
+#include <stdint.h>
+
+#include "io.h"
+
+// one member image of the array, stored either as raw bytes or as hex text
+typedef struct {
+    int fd; // -1 when the disk is absent
+    int hex; // image stores each byte as two lowercase hex characters
+    int dfd; // O_DIRECT descriptor for aligned transfers, -1 when not in use
+    const char *path;
+} disk_t;
+
+int disk_open(disk_t *d, const char *path, int hex, int flags); // flags as for open(2)
+int disk_create(disk_t *d, const char *path, int hex, int64_t K); // truncate; binary images become a K-byte hole
+int disk_open_direct(disk_t *d); // add an O_DIRECT descriptor to an open binary image
+void disk_close(disk_t *d);
+int64_t disk_size(disk_t *d); // logical bytes held by the image, -1 on error
+
+// all of these work in logical bytes and return 0 or -1 with errno set
+int disk_read(disk_t *d, unsigned char *buf, int64_t len, int64_t off);
+int disk_write(disk_t *d, const unsigned char *buf, int64_t len, int64_t off);
+int disk_write_sparse(disk_t *d, const unsigned char *buf, int64_t len, int64_t off, int64_t B); // fresh images: skip zero blocks
+int disk_write_zeros(disk_t *d, int64_t off, int64_t len); // punch a hole where the filesystem allows it
+int disk_sync(disk_t *d); // make every write so far durable
+
+// queue a transfer on io; aligned ones on a disk with dfd bypass the page cache.
+// Hex images are converted and transferred at once
+int disk_queue_read(io_t *io, disk_t *d, unsigned char *buf, int64_t len, int64_t off);
+int disk_queue_write(io_t *io, disk_t *d, const unsigned char *buf, int64_t len, int64_t off);
+
+int is_zero(const unsigned char *buf, int64_t len);
+
+// pread/pwrite the whole range, retrying short transfers and EINTR; a read past the end fails with EIO
+int full_pread(int fd, void *buf, int64_t len, int64_t off);
+int full_pwrite(int fd, const void *buf, int64_t len, int64_t off);
+
+// convert between bytes and lowercase hex pairs; decode returns the first bad byte or -1
+void hex_encode(const unsigned char *buf, int64_t len, char *hex);
+int64_t hex_decode(const char *hex, unsigned char *buf, int64_t len);
+
+#endif
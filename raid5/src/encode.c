@@ -0,0 +1,334 @@
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "gf256.h"
+#include "queue.h"
+#include "raid5.h"
+#include "xor.h"
+
+#define WINDOW_BYTES (1 << 18) // bytes per disk encoded between writes
+
+// a window of consecutive stripes travelling from the reader to the disk writers
+typedef struct {
+    int64_t first, count; // first stripe and number of stripes covered
+    char *raw; // input exactly as read: raw bytes or hex text
+    unsigned char *disks; // one region of window * B bytes per disk
+    int encoded, failed, pending; // encoding done, encoding failed, writers still to go
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} chunk_t;
+
+// everything the encoder stages share
+typedef struct {
+    raid5_geom_t g;
+    int64_t numDataBlocks, numStripes, window;
+    int perStripe, binary;
+    int raid6; // P and Q per stripe instead of a single XOR parity block
+    disk_t *disks; // fd is -1 for disks that could not be created
+    int failed; // set once any stage fails
+    pthread_mutex_t lock;
+    queue_t freeChunks, work, *diskQueues; // parallel mode only
+} encoder_t;
+
+// per-disk writer thread arguments
+typedef struct {
+    encoder_t *enc;
+    int disk;
+} writer_arg_t;
+
+
+static void setFailed(encoder_t *enc) {
+    pthread_mutex_lock(&enc->lock);
+    enc->failed = 1;
+    pthread_mutex_unlock(&enc->lock);
+}
+
+static int hasFailed(encoder_t *enc) {
+    pthread_mutex_lock(&enc->lock);
+    int failed = enc->failed;
+    pthread_mutex_unlock(&enc->lock);
+    return failed;
+}
+
+// read the input that belongs to the chunk's stripes
+static int readChunk(encoder_t *enc, FILE *fin, chunk_t *c) {
+    int64_t startBlock = c->first * enc->perStripe;
+    int64_t blocks = enc->numDataBlocks - startBlock;
+    if (blocks > c->count * enc->perStripe) blocks = c->count * enc->perStripe;
+    int64_t charsPerByte = enc->binary ? 1 : 2; // hex input uses two characters per byte
+    int64_t len = blocks * enc->g.B * charsPerByte;
+    int64_t got = (int64_t)fread(c->raw, 1, len, fin);
+    if (got != len) {
+        fprintf(stderr, "Error reading byte %" PRId64 "\n", startBlock * enc->g.B + got / charsPerByte);
+        return -1;
+    }
+    return 0;
+}
+
+// lay the chunk's data blocks out on their disks and compute each stripe's parity
+static int encodeChunk(encoder_t *enc, chunk_t *c) {
+    int N = enc->g.N, perStripe = enc->perStripe;
+    int64_t B = enc->g.B, window = enc->window;
+    memset(c->disks, 0, (size_t)(N * window * B)); // unused blocks and parity start out as zero
+
+    for (int64_t s = 0; s < c->count; s++) {
+        int64_t stripe = c->first + s; // calculate stripe index
+        int64_t stripeStartBlock = stripe * perStripe; // first data block of this stripe
+        int inStripe = enc->numDataBlocks - stripeStartBlock < perStripe
+                     ? (int)(enc->numDataBlocks - stripeStartBlock) : perStripe; // data blocks actually present
+
+        int parityDisk = enc->raid6 ? raid6_p_disk(&enc->g, stripe) : raid5_parity_disk(&enc->g, stripe);
+        unsigned char *parity = c->disks + (parityDisk * window + s) * B;
+        const unsigned char *blocks[RAID5_MAX_DISKS]; // data blocks in stripe order, for Q
+        for (int i = 0; i < perStripe; i++) {
+            int diskIndex = enc->raid6 ? raid6_data_disk(&enc->g, stripe, i) : raid5_data_disk(&enc->g, stripe, i);
+            blocks[i] = c->disks + (diskIndex * window + s) * B;
+        }
+        for (int i = 0; i < inStripe; i++) { // copy each data block to its disk
+            unsigned char *block = (unsigned char *)blocks[i];
+            int64_t inputOffset = (s * perStripe + i) * B; // logical offset within the chunk
+            if (enc->binary) {
+                memcpy(block, c->raw + inputOffset, B);
+            } else {
+                int64_t bad = hex_decode(c->raw + 2 * inputOffset, block, B);
+                if (bad >= 0) {
+                    fprintf(stderr, "Error reading byte %" PRId64 "\n", (stripeStartBlock + i) * B + bad);
+                    return -1;
+                }
+            }
+            if (!enc->raid6) xor_into(parity, block, B); // XOR this data block into the parity block
+        }
+        if (enc->raid6) { // blocks past the end of the input are still zero
+            unsigned char *q = c->disks + (raid6_q_disk(&enc->g, stripe) * window + s) * B;
+            gf256_gen_pq(blocks, perStripe, parity, q, B);
+        }
+    }
+    return 0;
+}
+
+// write one disk's region of an encoded chunk, leaving zero blocks as holes
+static int writeRegion(encoder_t *enc, int d, chunk_t *c) {
+    disk_t *disk = &enc->disks[d];
+    if (disk->fd < 0) return 0; // skip disks that could not be created
+    unsigned char *region = c->disks + d * enc->window * enc->g.B;
+    if (disk_write_sparse(disk, region, c->count * enc->g.B, c->first * enc->g.B, enc->g.B) != 0) {
+        perror(disk->path);
+        return -1;
+    }
+    return 0;
+}
+
+// hex disks hold every byte, so pad them with zeros past the last stripe
+static int padDisk(encoder_t *enc, int d) {
+    disk_t *disk = &enc->disks[d];
+    if (!disk->hex || disk->fd < 0) return 0; // binary disks were sized up front
+    if (disk_write_zeros(disk, enc->numStripes * enc->g.B, enc->g.K - enc->numStripes * enc->g.B) != 0) {
+        perror(disk->path);
+        return -1;
+    }
+    return 0;
+}
+
+static chunk_t *allocChunk(encoder_t *enc) {
+    chunk_t *c = calloc(1, sizeof(chunk_t));
+    if (!c) return NULL;
+    c->raw = malloc((size_t)((enc->binary ? 1 : 2) * enc->perStripe * enc->window * enc->g.B));
+    c->disks = malloc((size_t)(enc->g.N * enc->window * enc->g.B));
+    if (!c->raw || !c->disks) {
+        free(c->raw);
+        free(c->disks);
+        free(c);
+        return NULL;
+    }
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->ready, NULL);
+    return c;
+}
+
+static void freeChunk(chunk_t *c) {
+    if (!c) return;
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->ready);
+    free(c->raw);
+    free(c->disks);
+    free(c);
+}
+
+// encode and write one window at a time on the calling thread
+static int encodeSerial(encoder_t *enc, FILE *fin) {
+    chunk_t *c = allocChunk(enc);
+    if (!c) {
+        perror("Failed to allocate memory for disk array");
+        return -1;
+    }
+
+    int status = 0;
+    for (int64_t first = 0; first < enc->numStripes && status == 0; first += enc->window) {
+        c->first = first;
+        c->count = enc->numStripes - first < enc->window ? enc->numStripes - first : enc->window; // stripes in this pass
+        if (readChunk(enc, fin, c) != 0 || encodeChunk(enc, c) != 0) {
+            status = -1;
+            break;
+        }
+        for (int d = 0; d < enc->g.N; d++) { // write this window of stripes to every disk
+            if (writeRegion(enc, d, c) != 0) status = -1;
+        }
+    }
+    for (int d = 0; d < enc->g.N && status == 0; d++) {
+        status = padDisk(enc, d);
+    }
+    freeChunk(c);
+    return status;
+}
+
+// worker: encode chunks in whatever order they arrive
+static void *encodeWorker(void *arg) {
+    encoder_t *enc = arg;
+    chunk_t *c;
+    while ((c = queue_pop(&enc->work)) != NULL) {
+        int failed = encodeChunk(enc, c) != 0;
+        if (failed) setFailed(enc);
+        pthread_mutex_lock(&c->lock);
+        c->encoded = 1;
+        c->failed = failed;
+        pthread_cond_broadcast(&c->ready);
+        pthread_mutex_unlock(&c->lock);
+    }
+    return NULL;
+}
+
+// writer: drain one disk's queue in stripe order, recycling chunks once every disk has them
+static void *diskWriter(void *arg) {
+    writer_arg_t *w = arg;
+    encoder_t *enc = w->enc;
+    int d = w->disk;
+
+    chunk_t *c;
+    while ((c = queue_pop(&enc->diskQueues[d])) != NULL) {
+        pthread_mutex_lock(&c->lock);
+        while (!c->encoded) { // the queue holds chunks in order; wait for this one's encoding
+            pthread_cond_wait(&c->ready, &c->lock);
+        }
+        int failed = c->failed;
+        pthread_mutex_unlock(&c->lock);
+
+        if (!failed && !hasFailed(enc) && writeRegion(enc, d, c) != 0) setFailed(enc);
+
+        pthread_mutex_lock(&c->lock);
+        int last = --c->pending == 0;
+        pthread_mutex_unlock(&c->lock);
+        if (last) queue_push(&enc->freeChunks, c);
+    }
+    if (!hasFailed(enc) && padDisk(enc, d) != 0) setFailed(enc);
+    return NULL;
+}
+
+// read on the calling thread, encode on a worker pool and write each disk on its own thread
+static int encodeParallel(encoder_t *enc, FILE *fin, int threads) {
+    int N = enc->g.N;
+    int poolSize = threads + 2; // enough chunks for every worker plus one reading and one writing
+    chunk_t **pool = calloc(poolSize, sizeof(chunk_t *));
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    pthread_t *writers = malloc(N * sizeof(pthread_t));
+    writer_arg_t *writerArgs = malloc(N * sizeof(writer_arg_t));
+    enc->diskQueues = malloc(N * sizeof(queue_t));
+    int ok = pool && workers && writers && writerArgs && enc->diskQueues
+          && queue_init(&enc->freeChunks, poolSize) == 0
+          && queue_init(&enc->work, poolSize) == 0;
+    for (int d = 0; ok && d < N; d++) {
+        ok = queue_init(&enc->diskQueues[d], poolSize) == 0;
+    }
+    for (int i = 0; ok && i < poolSize; i++) {
+        ok = (pool[i] = allocChunk(enc)) != NULL;
+        if (ok) queue_push(&enc->freeChunks, pool[i]);
+    }
+    if (!ok) {
+        // queues are only torn down on the success path; this is a fatal exit anyway
+        perror("Failed to allocate memory for disk array");
+        return -1;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, encodeWorker, enc);
+    }
+    for (int d = 0; d < N; d++) {
+        writerArgs[d].enc = enc;
+        writerArgs[d].disk = d;
+        pthread_create(&writers[d], NULL, diskWriter, &writerArgs[d]);
+    }
+
+    for (int64_t first = 0; first < enc->numStripes; first += enc->window) {
+        chunk_t *c = queue_pop(&enc->freeChunks);
+        if (hasFailed(enc)) break;
+        c->first = first;
+        c->count = enc->numStripes - first < enc->window ? enc->numStripes - first : enc->window; // stripes in this chunk
+        if (readChunk(enc, fin, c) != 0) {
+            setFailed(enc);
+            break;
+        }
+        c->encoded = c->failed = 0;
+        c->pending = N;
+        queue_push(&enc->work, c);
+        for (int d = 0; d < N; d++) { // every disk sees the chunks in stripe order
+            queue_push(&enc->diskQueues[d], c);
+        }
+    }
+
+    queue_close(&enc->work);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    for (int d = 0; d < N; d++) {
+        queue_close(&enc->diskQueues[d]);
+    }
+    for (int d = 0; d < N; d++) {
+        pthread_join(writers[d], NULL);
+    }
+
+    for (int i = 0; i < poolSize; i++) {
+        freeChunk(pool[i]);
+    }
+    for (int d = 0; d < N; d++) {
+        queue_destroy(&enc->diskQueues[d]);
+    }
+    queue_destroy(&enc->freeChunks);
+    queue_destroy(&enc->work);
+    free(enc->diskQueues);
+    free(pool);
+    free(workers);
+    free(writers);
+    free(writerArgs);
+    return hasFailed(enc) ? -1 : 0;
+}
+
+static int encodeArray(const raid5_geom_t *g, disk_t *disks, FILE *input, int hexInput, int64_t J, int threads,
+                       int raid6) {
+    encoder_t enc = {0};
+    enc.g = *g;
+    enc.disks = disks;
+    enc.binary = !hexInput;
+    enc.raid6 = raid6;
+    enc.numDataBlocks = J / g->B; // number of data blocks in input data
+    enc.perStripe = g->N - (raid6 ? 2 : 1); // number of data disks in each stripe
+    enc.numStripes = (enc.numDataBlocks + enc.perStripe - 1) / enc.perStripe; // stripes holding data
+    enc.window = WINDOW_BYTES / g->B; // stripes encoded per pass
+    if (enc.window < 1) enc.window = 1;
+    if (enc.window > enc.numStripes) enc.window = enc.numStripes;
+    pthread_mutex_init(&enc.lock, NULL);
+
+    int status = threads > 1 ? encodeParallel(&enc, input, threads) : encodeSerial(&enc, input);
+    pthread_mutex_destroy(&enc.lock);
+    return status;
+}
+
+int raid5_encode(const raid5_geom_t *g, disk_t *disks, FILE *input, int hexInput, int64_t J, int threads) {
+    return encodeArray(g, disks, input, hexInput, J, threads, 0);
+}
+
+int raid6_encode(const raid5_geom_t *g, disk_t *disks, FILE *input, int hexInput, int64_t J, int threads) {
+    return encodeArray(g, disks, input, hexInput, J, threads, 1);
+}
@@ -0,0 +1,169 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "gf256.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static unsigned char gfExp[510]; // doubled so products never need a modulo
+static unsigned char gfLog[256];
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT;
+
+static void buildTables(void) {
+    unsigned int x = 1;
+    for (int i = 0; i < 255; i++) {
+        gfExp[i] = gfExp[i + 255] = (unsigned char)x;
+        gfLog[x] = (unsigned char)i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x11d;
+    }
+}
+
+unsigned char gf256_mul(unsigned char a, unsigned char b) {
+    pthread_once(&tablesOnce, buildTables);
+    if (a == 0 || b == 0) return 0;
+    return gfExp[gfLog[a] + gfLog[b]];
+}
+
+unsigned char gf256_inv(unsigned char a) {
+    pthread_once(&tablesOnce, buildTables);
+    return gfExp[255 - gfLog[a]];
+}
+
+unsigned char gf256_pow2(int power) {
+    pthread_once(&tablesOnce, buildTables);
+    power %= 255;
+    if (power < 0) power += 255;
+    return gfExp[power];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// multiplying by 2 is a shift plus a conditional reduction, so Q costs about as much as P
+__attribute__((target("avx2")))
+static size_t genPqAvx2(const unsigned char *const *data, int n, unsigned char *p, unsigned char *q, size_t len) {
+    const __m256i poly = _mm256_set1_epi8(0x1d), zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) { // two independent 32-byte lanes hide the shift/compare latency
+        __m256i p0 = _mm256_loadu_si256((const __m256i *)(data[n - 1] + i));
+        __m256i p1 = _mm256_loadu_si256((const __m256i *)(data[n - 1] + i + 32));
+        __m256i q0 = p0, q1 = p1;
+        for (int d = n - 2; d >= 0; d--) { // Horner: Q = Q * 2 + D
+            __m256i d0 = _mm256_loadu_si256((const __m256i *)(data[d] + i));
+            __m256i d1 = _mm256_loadu_si256((const __m256i *)(data[d] + i + 32));
+            __m256i c0 = _mm256_cmpgt_epi8(zero, q0); // 0xff where the top bit is set
+            __m256i c1 = _mm256_cmpgt_epi8(zero, q1);
+            q0 = _mm256_xor_si256(_mm256_add_epi8(q0, q0), _mm256_and_si256(c0, poly));
+            q1 = _mm256_xor_si256(_mm256_add_epi8(q1, q1), _mm256_and_si256(c1, poly));
+            q0 = _mm256_xor_si256(q0, d0);
+            q1 = _mm256_xor_si256(q1, d1);
+            p0 = _mm256_xor_si256(p0, d0);
+            p1 = _mm256_xor_si256(p1, d1);
+        }
+        _mm256_storeu_si256((__m256i *)(p + i), p0);
+        _mm256_storeu_si256((__m256i *)(p + i + 32), p1);
+        _mm256_storeu_si256((__m256i *)(q + i), q0);
+        _mm256_storeu_si256((__m256i *)(q + i + 32), q1);
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t genPqSse2(const unsigned char *const *data, int n, unsigned char *p, unsigned char *q, size_t len) {
+    const __m128i poly = _mm_set1_epi8(0x1d), zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i pv = _mm_loadu_si128((const __m128i *)(data[n - 1] + i));
+        __m128i qv = pv;
+        for (int d = n - 2; d >= 0; d--) {
+            __m128i dv = _mm_loadu_si128((const __m128i *)(data[d] + i));
+            __m128i carry = _mm_cmpgt_epi8(zero, qv);
+            qv = _mm_xor_si128(_mm_add_epi8(qv, qv), _mm_and_si128(carry, poly));
+            qv = _mm_xor_si128(qv, dv);
+            pv = _mm_xor_si128(pv, dv);
+        }
+        _mm_storeu_si128((__m128i *)(p + i), pv);
+        _mm_storeu_si128((__m128i *)(q + i), qv);
+    }
+    return i;
+}
+
+// c * x = lo[x & 15] ^ hi[x >> 4], sixteen table lookups per pshufb
+__attribute__((target("avx2")))
+static size_t mulIntoAvx2(unsigned char *dst, const unsigned char *src, const unsigned char *lo16,
+                          const unsigned char *hi16, size_t len) {
+    const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lo16));
+    const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hi16));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, mask));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(l, h)));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static size_t mulIntoSsse3(unsigned char *dst, const unsigned char *src, const unsigned char *lo16,
+                           const unsigned char *hi16, size_t len) {
+    const __m128i lo = _mm_loadu_si128((const __m128i *)lo16);
+    const __m128i hi = _mm_loadu_si128((const __m128i *)hi16);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(x, mask));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+    }
+    return i;
+}
+#endif
+
+static unsigned char mul2(unsigned char x) {
+    return (unsigned char)((x << 1) ^ (x & 0x80 ? 0x1d : 0));
+}
+
+void gf256_gen_pq(const unsigned char *const *data, int n, unsigned char *p, unsigned char *q, size_t len) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        i = genPqAvx2(data, n, p, q, len);
+    } else if (__builtin_cpu_supports("sse2")) {
+        i = genPqSse2(data, n, p, q, len);
+    }
+#endif
+    for (; i < len; i++) {
+        unsigned char pv = data[n - 1][i], qv = pv;
+        for (int d = n - 2; d >= 0; d--) {
+            qv = mul2(qv) ^ data[d][i];
+            pv ^= data[d][i];
+        }
+        p[i] = pv;
+        q[i] = qv;
+    }
+}
+
+void gf256_mul_into(unsigned char *dst, const unsigned char *src, unsigned char c, size_t len) {
+    unsigned char lo[16], hi[16];
+    for (int x = 0; x < 16; x++) {
+        lo[x] = gf256_mul(c, (unsigned char)x);
+        hi[x] = gf256_mul(c, (unsigned char)(x << 4));
+    }
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        i = mulIntoAvx2(dst, src, lo, hi, len);
+    } else if (__builtin_cpu_supports("ssse3")) {
+        i = mulIntoSsse3(dst, src, lo, hi, len);
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+    }
+}
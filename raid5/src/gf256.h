@@ -0,0 +1,18 @@
+#ifndef __GF256_HEADER__
+#define __GF256_HEADER__
+
+#include <stddef.h>
+
+// arithmetic in GF(2^8) with the RAID-6 polynomial x^8 + x^4 + x^3 + x^2 + 1 and generator 2
+
+unsigned char gf256_mul(unsigned char a, unsigned char b);
+unsigned char gf256_inv(unsigned char a); // a must be non-zero
+unsigned char gf256_pow2(int power); // 2^power, power may be negative
+
+// P = XOR of the n data blocks, Q = sum of 2^i * data[i], in one pass over memory
+void gf256_gen_pq(const unsigned char *const *data, int n, unsigned char *p, unsigned char *q, size_t len);
+
+// dst ^= c * src, using 4-bit lookup tables and pshufb where available
+void gf256_mul_into(unsigned char *dst, const unsigned char *src, unsigned char c, size_t len);
+
+#endif
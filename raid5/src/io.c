@@ -0,0 +1,319 @@
+#define _GNU_SOURCE // pread, pwrite and syscall under -std=c99
+#define _FILE_OFFSET_BITS 64
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/uio.h>
+
+#include "io.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define HAVE_URING 1
+#endif
+
+#define IO_CHUNK (1 << 17) // largest single request handed to the kernel
+
+static int ioDepth = 1;
+
+// the part of one request still to be transferred
+typedef struct {
+    int fd, write;
+    struct iovec iov;
+    int64_t off;
+} io_slot_t;
+
+struct io {
+    int backend, failed, err;
+    int numSlots, inflight;
+    io_slot_t *slots;
+    int *freeSlots, numFree;
+#ifdef HAVE_URING
+    int ringFd; // -1 once the ring has failed and takes no more work
+    unsigned submitPending; // SQEs queued since the last io_uring_enter
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray, *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqRing, *cqRing;
+    size_t sqRingSize, cqRingSize, sqesSize;
+#endif
+};
+
+void io_set_depth(int depth) {
+    ioDepth = depth < 1 ? 1 : depth;
+}
+
+int io_get_depth(void) {
+    return ioDepth;
+}
+
+int io_backend(const io_t *io) {
+    return io->backend;
+}
+
+const char *io_backend_name(int backend) {
+    return backend == IO_URING ? "io_uring" : "psync";
+}
+
+static void setError(io_t *io, int err) {
+    if (!io->failed) io->err = err;
+    io->failed = 1;
+}
+
+// synchronous transfer with retries on short counts and EINTR
+static int transfer(int fd, int write, unsigned char *buf, int64_t len, int64_t off) {
+    while (len > 0) {
+        ssize_t n = write ? pwrite(fd, buf, len, off) : pread(fd, buf, len, off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO; // read past the end of the image
+            return -1;
+        }
+        buf += n;
+        len -= n;
+        off += n;
+    }
+    return 0;
+}
+
+#ifdef HAVE_URING
+static int uringSetup(io_t *io, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    io->ringFd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (io->ringFd < 0) return -1;
+
+    io->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    io->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    io->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    io->sqRing = mmap(NULL, io->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ringFd,
+                      IORING_OFF_SQ_RING);
+    io->cqRing = mmap(NULL, io->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ringFd,
+                      IORING_OFF_CQ_RING);
+    io->sqes = mmap(NULL, io->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ringFd,
+                    IORING_OFF_SQES);
+    if (io->sqRing == MAP_FAILED || io->cqRing == MAP_FAILED || io->sqes == MAP_FAILED) {
+        if (io->sqRing != MAP_FAILED) munmap(io->sqRing, io->sqRingSize);
+        if (io->cqRing != MAP_FAILED) munmap(io->cqRing, io->cqRingSize);
+        if (io->sqes != MAP_FAILED) munmap(io->sqes, io->sqesSize);
+        close(io->ringFd);
+        return -1;
+    }
+    unsigned char *sq = io->sqRing, *cq = io->cqRing;
+    io->sqHead = (unsigned *)(sq + p.sq_off.head);
+    io->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    io->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    io->sqArray = (unsigned *)(sq + p.sq_off.array);
+    io->cqHead = (unsigned *)(cq + p.cq_off.head);
+    io->cqTail = (unsigned *)(cq + p.cq_off.tail);
+    io->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    io->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    if (p.sq_entries < (unsigned)io->numSlots) io->numSlots = (int)p.sq_entries;
+    return 0;
+}
+
+static void uringTeardown(io_t *io) {
+    munmap(io->sqRing, io->sqRingSize);
+    munmap(io->cqRing, io->cqRingSize);
+    munmap(io->sqes, io->sqesSize);
+    if (io->ringFd >= 0) close(io->ringFd);
+}
+
+// put the remainder of a slot on the submission queue
+static void uringPush(io_t *io, int slot) {
+    io_slot_t *s = &io->slots[slot];
+    unsigned tail = *io->sqTail; // only this thread writes the tail
+    unsigned index = tail & *io->sqMask;
+    struct io_uring_sqe *sqe = &io->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = s->write ? IORING_OP_WRITEV : IORING_OP_READV; // vectored ops work on every io_uring kernel
+    sqe->fd = s->fd;
+    sqe->off = (uint64_t)s->off;
+    sqe->addr = (uint64_t)(uintptr_t)&s->iov;
+    sqe->len = 1;
+    sqe->user_data = (uint64_t)slot;
+    io->sqArray[index] = index;
+    __atomic_store_n(io->sqTail, tail + 1, __ATOMIC_RELEASE);
+    io->submitPending++;
+}
+
+// handle every completion posted so far; returns how many there were
+static unsigned uringComplete(io_t *io) {
+    unsigned head = *io->cqHead;
+    unsigned tail = __atomic_load_n(io->cqTail, __ATOMIC_ACQUIRE);
+    unsigned count = tail - head;
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &io->cqes[head & *io->cqMask];
+        int slot = (int)cqe->user_data;
+        io_slot_t *s = &io->slots[slot];
+        int res = cqe->res;
+        int retry = res == -EINTR || res == -EAGAIN || (res > 0 && (size_t)res < s->iov.iov_len);
+        if (retry && io->ringFd >= 0) { // a dead ring takes nothing new
+            if (res > 0) { // short transfer: queue the rest
+                s->iov.iov_base = (unsigned char *)s->iov.iov_base + res;
+                s->iov.iov_len -= res;
+                s->off += res;
+            }
+            uringPush(io, slot); // otherwise try the same transfer again
+            continue;
+        }
+        if (retry) setError(io, EIO);
+        if (res < 0) setError(io, -res);
+        if (res == 0 && s->iov.iov_len > 0) setError(io, EIO);
+        io->freeSlots[io->numFree++] = slot;
+        io->inflight--;
+    }
+    __atomic_store_n(io->cqHead, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+// io_uring_enter failed for good: withdraw what the kernel never took and wait out what it did,
+// so no buffer is released while the kernel may still use it
+static void uringAbandon(io_t *io, int err) {
+    setError(io, err);
+    unsigned head = __atomic_load_n(io->sqHead, __ATOMIC_ACQUIRE);
+    io->inflight -= (int)(*io->sqTail - head); // queued but never consumed, so never started
+    __atomic_store_n(io->sqTail, head, __ATOMIC_RELEASE);
+    io->submitPending = 0;
+    close(io->ringFd); // the mappings keep the ring alive, so completions still arrive
+    io->ringFd = -1;
+    while (io->inflight > 0) {
+        if (uringComplete(io) == 0) {
+            struct timespec pause = {0, 1000000}; // nothing yet, check back in a millisecond
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+// submit what is queued and handle at least minDone completions
+static void uringReap(io_t *io, unsigned minDone) {
+    if (io->ringFd < 0) return; // abandoned, nothing is outstanding
+    for (;;) {
+        int n = (int)syscall(__NR_io_uring_enter, io->ringFd, io->submitPending, minDone, IORING_ENTER_GETEVENTS,
+                             NULL, 0);
+        if (n >= 0) {
+            io->submitPending -= (unsigned)n < io->submitPending ? (unsigned)n : io->submitPending;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EBUSY) { // short of resources or completions: reap, then try again later
+            if (uringComplete(io) == 0) sched_yield();
+            return;
+        }
+        uringAbandon(io, errno);
+        return;
+    }
+    uringComplete(io);
+}
+#endif
+
+io_t *io_open(int members) {
+    io_t *io = calloc(1, sizeof(io_t));
+    if (!io) return NULL;
+    io->backend = IO_PSYNC;
+    io->numSlots = ioDepth * (members < 1 ? 1 : members);
+#ifdef HAVE_URING
+    if (ioDepth > 1 && uringSetup(io, (unsigned)io->numSlots) == 0) io->backend = IO_URING;
+    // kernels without io_uring (or sandboxes that forbid it) keep the pread/pwrite path
+#endif
+    if (io->backend == IO_URING) {
+        io->slots = malloc(io->numSlots * sizeof(io_slot_t));
+        io->freeSlots = malloc(io->numSlots * sizeof(int));
+        if (!io->slots || !io->freeSlots) {
+#ifdef HAVE_URING
+            uringTeardown(io);
+#endif
+            free(io->slots);
+            free(io->freeSlots);
+            free(io);
+            errno = ENOMEM;
+            return NULL;
+        }
+        for (int i = 0; i < io->numSlots; i++) {
+            io->freeSlots[i] = i;
+        }
+        io->numFree = io->numSlots;
+    }
+    return io;
+}
+
+static int submit(io_t *io, int fd, int write, unsigned char *buf, int64_t len, int64_t off) {
+    if (io->failed) {
+        errno = io->err;
+        return -1;
+    }
+    if (io->backend == IO_PSYNC) {
+        if (transfer(fd, write, buf, len, off) != 0) {
+            setError(io, errno);
+            return -1;
+        }
+        return 0;
+    }
+#ifdef HAVE_URING
+    for (int64_t done = 0; done < len && !io->failed; done += IO_CHUNK) {
+        while (io->numFree == 0 && !io->failed) { // every slot busy: wait for one to come back
+            uringReap(io, 1);
+        }
+        if (io->failed) break;
+        int slot = io->freeSlots[--io->numFree];
+        io_slot_t *s = &io->slots[slot];
+        s->fd = fd;
+        s->write = write;
+        s->iov.iov_base = buf + done;
+        s->iov.iov_len = (size_t)(len - done < IO_CHUNK ? len - done : IO_CHUNK);
+        s->off = off + done;
+        io->inflight++;
+        uringPush(io, slot);
+    }
+#endif
+    if (io->failed) {
+        errno = io->err;
+        return -1;
+    }
+    return 0;
+}
+
+void *io_alloc(size_t len) {
+    void *p;
+    return posix_memalign(&p, 4096, len ? len : 1) == 0 ? p : NULL;
+}
+
+int io_read(io_t *io, int fd, void *buf, int64_t len, int64_t off) {
+    return submit(io, fd, 0, buf, len, off);
+}
+
+int io_write(io_t *io, int fd, const void *buf, int64_t len, int64_t off) {
+    return submit(io, fd, 1, (unsigned char *)buf, len, off); // never written through
+}
+
+int io_wait(io_t *io) {
+#ifdef HAVE_URING
+    while (io->backend == IO_URING && io->inflight > 0) {
+        uringReap(io, 1);
+    }
+#endif
+    if (io->failed) {
+        errno = io->err;
+        return -1;
+    }
+    return 0;
+}
+
+void io_close(io_t *io) {
+    if (!io) return;
+    io_wait(io);
+#ifdef HAVE_URING
+    if (io->backend == IO_URING) uringTeardown(io);
+#endif
+    free(io->slots);
+    free(io->freeSlots);
+    free(io);
+}
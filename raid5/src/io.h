@@ -0,0 +1,32 @@
+#ifndef __IO_HEADER__
+#define __IO_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// batches of member reads and writes kept in flight together: io_uring when the
+// kernel offers it and more than one request may be outstanding, otherwise
+// plain pread/pwrite one request at a time
+typedef struct io io_t;
+
+enum { IO_PSYNC, IO_URING };
+
+// settings used by io_open; depth is the number of requests in flight per member
+void io_set_depth(int depth);
+int io_get_depth(void);
+
+io_t *io_open(int members); // NULL with errno set
+int io_backend(const io_t *io); // IO_PSYNC or IO_URING
+const char *io_backend_name(int backend);
+
+// queue a transfer; it may start at once and may be split, but buf must stay
+// untouched until io_wait. Returns -1 once any transfer on io has failed
+int io_read(io_t *io, int fd, void *buf, int64_t len, int64_t off);
+int io_write(io_t *io, int fd, const void *buf, int64_t len, int64_t off);
+
+void *io_alloc(size_t len); // buffer aligned for O_DIRECT transfers; release with free
+
+int io_wait(io_t *io); // finish everything queued; 0, or -1 with errno from the first failure
+void io_close(io_t *io); // waits first
+
+#endif
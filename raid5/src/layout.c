@@ -0,0 +1,47 @@
+#include <string.h>
+
+#include "raid5.h"
+
+static const char *layoutNames[RAID5_NUM_LAYOUTS] = {
+    "left-symmetric", "left-asymmetric", "right-symmetric", "right-asymmetric", "raid4"
+};
+
+int raid5_geom_valid(const raid5_geom_t *g) {
+    return g->B >= 1 && g->B <= RAID5_MAX_BLOCK // block size must be positive and at most the maximum
+        && g->K >= 1 && g->K % g->B == 0 // size of each disk must be positive and a multiple of block size
+        && g->N >= 2 && g->N <= RAID5_MAX_DISKS // need a data disk besides parity
+        && g->K / g->B <= INT64_MAX / g->B / (g->N - 1) // capacity must fit in 64 bits
+        && g->layout >= 0 && g->layout < RAID5_NUM_LAYOUTS;
+}
+
+int raid5_geom_init(raid5_geom_t *g) {
+    if (!raid5_geom_valid(g)) return -1;
+    int N = g->N;
+    for (int s = 0; s < N; s++) { // every layout repeats after N stripes
+        int parity = g->layout == RAID5_LEFT_SYMMETRIC || g->layout == RAID5_LEFT_ASYMMETRIC ? N - 1 - s
+                   : g->layout == RAID5_RAID4 ? N - 1 : s;
+        g->parityMap[s] = (unsigned char)parity;
+        for (int i = 0; i < N - 1; i++) {
+            int symmetric = g->layout == RAID5_LEFT_SYMMETRIC || g->layout == RAID5_RIGHT_SYMMETRIC;
+            int disk = symmetric ? (parity + 1 + i) % N // data starts right after parity and wraps around
+                     : i < parity ? i : i + 1; // data fills the remaining disks in order
+            g->dataMap[s][i] = (unsigned char)disk;
+        }
+    }
+    return 0;
+}
+
+int64_t raid5_capacity(const raid5_geom_t *g) {
+    return g->K / g->B * (g->N - 1) * g->B;
+}
+
+int raid5_layout_parse(const char *name) {
+    for (int i = 0; i < RAID5_NUM_LAYOUTS; i++) {
+        if (strcmp(name, layoutNames[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char *raid5_layout_name(int layout) {
+    return layout >= 0 && layout < RAID5_NUM_LAYOUTS ? layoutNames[layout] : "unknown";
+}
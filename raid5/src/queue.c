@@ -0,0 +1,58 @@
+#include <stdlib.h>
+
+#include "queue.h"
+
+int queue_init(queue_t *q, int capacity) {
+    q->items = malloc(capacity * sizeof(void *));
+    if (!q->items) return -1;
+    q->capacity = capacity;
+    q->head = q->count = q->closed = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+    return 0;
+}
+
+void queue_destroy(queue_t *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_cond_destroy(&q->notFull);
+    free(q->items);
+}
+
+void queue_push(queue_t *q, void *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->capacity && !q->closed) { // wait for room
+        pthread_cond_wait(&q->notFull, &q->lock);
+    }
+    if (!q->closed) {
+        q->items[(q->head + q->count) % q->capacity] = item;
+        q->count++;
+        pthread_cond_signal(&q->notEmpty);
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+void *queue_pop(queue_t *q) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed) { // wait for an item
+        pthread_cond_wait(&q->notEmpty, &q->lock);
+    }
+    void *item = NULL;
+    if (q->count > 0) {
+        item = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_signal(&q->notFull);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+void queue_close(queue_t *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_cond_broadcast(&q->notFull);
+    pthread_mutex_unlock(&q->lock);
+}
@@ -0,0 +1,20 @@
+#ifndef __QUEUE_HEADER__
+#define __QUEUE_HEADER__
+
+#include <pthread.h>
+
+// bounded blocking FIFO of pointers shared between threads
+typedef struct {
+    void **items;
+    int capacity, head, count, closed;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty, notFull;
+} queue_t;
+
+int queue_init(queue_t *q, int capacity);
+void queue_destroy(queue_t *q);
+void queue_push(queue_t *q, void *item); // blocks while the queue is full
+void *queue_pop(queue_t *q); // blocks while empty; NULL once closed and drained
+void queue_close(queue_t *q); // wake every waiter, no more pushes
+
+#endif
@@ -1,126 +1,590 @@
+#define _GNU_SOURCE // enable getopt, sysconf and fseeko under -std=c99
+#define _FILE_OFFSET_BITS 64 // 64-bit ftello on 32-bit platforms too
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "raid5.h"
 
 // RAID-5 implementation: minimum of 3 disks, 1 parity disk
 
-int main(int argc, char *argv[]) { // command line arguments, array of strings holding each
-    if (argc < 6) { // error if not enough arguments
-        fprintf(stderr, "Usage: %s B J input_file K disk0 disk1 ... diskN-1\n", argv[0]);
+#define READ_STEP (1 << 22) // logical bytes fetched per raid5_read call in read mode
+#define UPDATE_STEP (1 << 22) // logical bytes handed to raid5_update at a time in update mode
+
+// parse a non-negative decimal size into 64 bits, rejecting garbage and overflow
+static int parseSize(const char *str, int64_t *out) {
+    char *end;
+    errno = 0;
+    long long value = strtoll(str, &end, 10);
+    if (errno != 0 || end == str || *end != '\0' || value < 0) return -1;
+    *out = value;
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-b] [-t threads] [-l layout] B J input_file K disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s rebuild [-b] [-t threads] B K missing disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s read [-b] [-l layout] [-m missing] B K offset length disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s update [-b] [-l layout] B K offset input_file disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s reshape [-b] [-l layout] B K checkpoint_file disk0 disk1 ... diskN-1 new_disk\n", prog);
+    fprintf(stderr, "       %s raid6 [-b] [-t threads] B J input_file K disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s checksum [-b] [-t threads] B K checksum_file disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s scrub [-b] [-t threads] [-6] [-c checksum_file] B K disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s raid6-rebuild [-b] [-t threads] B K missing[,missing] disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "Every mode also takes -q depth (reads in flight per disk; above 1 uses io_uring where the\n"
+                    "kernel has it), and every mode but encode and raid6 takes -D (O_DIRECT for aligned\n"
+                    "transfers on binary images).\n");
+    fprintf(stderr, "Layouts:");
+    for (int i = 0; i < RAID5_NUM_LAYOUTS; i++) {
+        fprintf(stderr, " %s%s", raid5_layout_name(i), i == RAID5_LEFT_SYMMETRIC ? " (default)" : "");
+    }
+    fprintf(stderr, "\n");
+}
+
+// command line flags shared by every mode
+typedef struct {
+    int binary; // raw bytes in and out instead of hex text
+    int threads; // worker threads; 1 keeps everything on the main thread
+    int missing; // disk to treat as failed, -1 for none
+    int layout; // placement of parity and data
+    int raid6; // the array carries P and Q parity
+    const char *checksums; // sidecar file of block checksums, NULL for none
+    int direct; // bypass the page cache where transfers are aligned
+} options_t;
+
+// parse the flags; leaves optind at the first positional argument
+static int parseOptions(int argc, char *argv[], options_t *opts) {
+    opts->binary = 0;
+    opts->threads = 1;
+    opts->missing = -1;
+    opts->layout = RAID5_LEFT_SYMMETRIC;
+    opts->raid6 = 0;
+    opts->checksums = NULL;
+    opts->direct = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "+bt:m:l:6c:q:D")) != -1) {
+        if (opt == 'b') {
+            opts->binary = 1;
+        } else if (opt == 't') {
+            opts->threads = atoi(optarg);
+            if (opts->threads == 0) opts->threads = (int)sysconf(_SC_NPROCESSORS_ONLN); // 0 means one per core
+            if (opts->threads < 1) return -1;
+        } else if (opt == 'm') {
+            opts->missing = atoi(optarg);
+            if (opts->missing < 0) return -1;
+        } else if (opt == 'l') {
+            opts->layout = raid5_layout_parse(optarg);
+            if (opts->layout < 0) return -1;
+        } else if (opt == '6') {
+            opts->raid6 = 1;
+        } else if (opt == 'c') {
+            opts->checksums = optarg;
+        } else if (opt == 'q') {
+            int depth = atoi(optarg);
+            if (depth < 1) return -1;
+            io_set_depth(depth);
+        } else if (opt == 'D') {
+            opts->direct = 1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// open every member except skip (pass -1 to open all) and check it covers K bytes
+static int openDisks(disk_t *disks, char **paths, int N, int skip, const options_t *opts, int flags, int64_t K) {
+    for (int d = 0; d < N; d++) {
+        disks[d].fd = -1;
+        disks[d].path = paths[d];
+        disks[d].hex = !opts->binary;
+    }
+    for (int d = 0; d < N; d++) {
+        if (d == skip) continue;
+        if (disk_open(&disks[d], paths[d], !opts->binary, flags) != 0
+         || (opts->direct && opts->binary && disk_open_direct(&disks[d]) != 0)) {
+            perror(paths[d]);
+            return -1;
+        }
+        if (disk_size(&disks[d]) < K) {
+            fprintf(stderr, "%s: disk image is smaller than %" PRId64 " bytes\n", paths[d], K);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void closeDisks(disk_t *disks, int N) {
+    for (int d = 0; d < N; d++) {
+        disk_close(&disks[d]);
+    }
+}
+
+// create an array from an input file
+static int encodeCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 5) { // error if not enough arguments
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    if (opts.direct) { // new images are written through the page cache
+        fprintf(stderr, "-D is not supported when creating an array.\n");
         return EXIT_FAILURE;
     }
+    argv += optind;
 
     // parse command line arguments
-    int B = atoi(argv[1]); // block size
-    int J = atoi(argv[2]); // total size of input file
-    char *inputPath = argv[3]; // path to input file
-    int K = atoi(argv[4]); // size of each disk
-    int N = argc - 5; // number of disks
-    char **diskPaths = &argv[5]; // paths to disks
+    raid5_geom_t g; // block size, size of each disk, number of disks and layout
+    int64_t J; // total size of input file
+    char *inputPath = argv[2]; // path to input file
+    g.layout = opts.layout;
+    g.N = argc - optind - 4; // number of disks
+    char **diskPaths = &argv[4]; // paths to disks
 
     // validate parameters as instructed
-    if (B < 1 || B > (1<<12) // block size must be positive and less than 4096
-     || J < 1 || J % B != 0 // total size must be positive and a multiple of block size
-     || K < 1 || K % B != 0 // size of each disk must be positive and a multiple of block size
-     || (long long)K * (N - 1) < J) { // total size must be less than or equal to size of all disks minus parity disk
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &J) || parseSize(argv[3], &g.K)
+     || raid5_geom_init(&g) != 0 // block size, disk size, disk count and layout must describe an array
+     || J < 1 || J % g.B != 0 // total size must be positive and a multiple of block size
+     || g.K * (g.N - 1) < J) { // total size must be less than or equal to size of all disks minus parity disk
         fprintf(stderr, "Invalid parameters.\n");
         return EXIT_FAILURE;
     }
 
-    unsigned char *inputData = malloc(J); // allocate memory for input data
-    if (!inputData) { 
-        perror("Failed to allocate memory for input data"); 
-        return EXIT_FAILURE; } // error if memory allocation fails
-
-    FILE *fin = fopen(inputPath, "r"); // open input file
+    FILE *fin = fopen(inputPath, opts.binary ? "rb" : "r"); // open input file
     if (!fin) { // error if file cannot be opened
-        perror("Failed to open input file"); 
-        free(inputData); // free memory for input data
-        return EXIT_FAILURE;
-    } 
-
-    // read input data from file
-    for (int i = 0; i < J; i++) { // read input data
-        char hex[3] = {0}; // buffer for hex string
-        if (fread(hex, 1, 2, fin) != 2) { // read two bytes at a time
-            fprintf(stderr, "Error reading byte %d\n", i);
-            fclose(fin); // close input file
-            free(inputData); // free memory for input data
-            return EXIT_FAILURE;
+        perror("Failed to open input file");
+        return EXIT_FAILURE;
+    }
+
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    if (!disks) {
+        perror("Failed to allocate memory for disk array");
+        fclose(fin);
+        return EXIT_FAILURE;
+    }
+
+    // create disks; binary images are sized up front so untouched regions are holes
+    for (int d = 0; d < g.N; d++) {
+        if (disk_create(&disks[d], diskPaths[d], !opts.binary, g.K) != 0) {
+            perror(diskPaths[d]); // skip this disk, as with any disk that cannot be opened
         }
-        inputData[i] = (unsigned char) strtol(hex, NULL, 16); // convert hex string to byte
     }
+
+    int status = raid5_encode(&g, disks, fin, !opts.binary, J, opts.threads) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     fclose(fin); // close input file
 
-    unsigned char **disks = malloc(N * sizeof(unsigned char *)); // allocate memory for disks
-    if (!disks) { // error if memory allocation fails
+    closeDisks(disks, g.N);
+    free(disks);
+    return status; // return success
+}
+
+// add a member to the array, restriping it in place
+static int reshapeCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 6) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g; // geometry before the new disk joins
+    char *checkpointPath = argv[2];
+    g.layout = opts.layout;
+    g.N = argc - optind - 4;
+    char **diskPaths = &argv[3];
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &g.K) || raid5_geom_init(&g) != 0
+     || g.N + 1 > RAID5_MAX_DISKS) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    disk_t *disks = malloc((g.N + 1) * sizeof(disk_t));
+    if (!disks) {
+        perror("Failed to allocate memory for disk array");
+        return EXIT_FAILURE;
+    }
+    // the new member is opened or created by raid5_reshape
+    int status = openDisks(disks, diskPaths, g.N + 1, g.N, &opts, O_RDWR, g.K) == 0
+              && raid5_reshape(&g, disks, checkpointPath) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    closeDisks(disks, g.N + 1);
+    free(disks);
+    return status;
+}
+
+// create a RAID-6 array (P and Q parity) from an input file
+static int raid6Command(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 5) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    if (opts.direct) { // new images are written through the page cache
+        fprintf(stderr, "-D is not supported when creating an array.\n");
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g;
+    int64_t J;
+    char *inputPath = argv[2];
+    g.layout = RAID5_LEFT_SYMMETRIC;
+    g.N = argc - optind - 4;
+    char **diskPaths = &argv[4];
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &J) || parseSize(argv[3], &g.K)
+     || raid5_geom_init(&g) != 0 || g.N < 3 // need a data disk besides P and Q
+     || J < 1 || J % g.B != 0 || raid6_capacity(&g) < J) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *fin = fopen(inputPath, opts.binary ? "rb" : "r");
+    if (!fin) {
+        perror("Failed to open input file");
+        return EXIT_FAILURE;
+    }
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    if (!disks) {
+        perror("Failed to allocate memory for disk array");
+        fclose(fin);
+        return EXIT_FAILURE;
+    }
+    for (int d = 0; d < g.N; d++) {
+        if (disk_create(&disks[d], diskPaths[d], !opts.binary, g.K) != 0) {
+            perror(diskPaths[d]);
+        }
+    }
+
+    int status = raid6_encode(&g, disks, fin, !opts.binary, J, opts.threads) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    fclose(fin);
+    closeDisks(disks, g.N);
+    free(disks);
+    return status;
+}
+
+// recreate up to two lost RAID-6 members from the survivors
+static int raid6RebuildCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 6) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g;
+    int missing[2], count = 0; // "a" or "a,b"
+    g.layout = RAID5_LEFT_SYMMETRIC;
+    g.N = argc - optind - 3;
+    char **diskPaths = &argv[3];
+    char *spec = argv[2], *comma = strchr(spec, ',');
+    int64_t index;
+    if (comma) *comma = '\0';
+    if (parseSize(spec, &index) == 0 && index < RAID5_MAX_DISKS) missing[count++] = (int)index;
+    if (comma && parseSize(comma + 1, &index) == 0 && index < RAID5_MAX_DISKS) missing[count++] = (int)index;
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &g.K) || raid5_geom_init(&g) != 0 || g.N < 3
+     || count != (comma ? 2 : 1) || missing[0] >= g.N || missing[count - 1] >= g.N
+     || (count == 2 && missing[0] == missing[1])) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    if (!disks) {
+        perror("Failed to allocate memory for disk array");
+        return EXIT_FAILURE;
+    }
+    // survivors must cover K bytes like in openDisks; the lost members are recreated empty
+    int status = EXIT_SUCCESS;
+    for (int d = 0; d < g.N; d++) {
+        disks[d].fd = -1;
+    }
+    for (int d = 0; d < g.N && status == EXIT_SUCCESS; d++) {
+        int lost = d == missing[0] || d == missing[count - 1];
+        if (lost ? disk_create(&disks[d], diskPaths[d], !opts.binary, g.K) != 0
+                 : disk_open(&disks[d], diskPaths[d], !opts.binary, O_RDONLY) != 0
+                || (opts.direct && opts.binary && disk_open_direct(&disks[d]) != 0)) {
+            perror(diskPaths[d]);
+            status = EXIT_FAILURE;
+        } else if (!lost && disk_size(&disks[d]) < g.K) {
+            fprintf(stderr, "%s: disk image is smaller than %" PRId64 " bytes\n", diskPaths[d], g.K);
+            status = EXIT_FAILURE;
+        }
+    }
+    if (status == EXIT_SUCCESS && raid6_rebuild(&g, disks, missing, count, opts.threads) != 0) status = EXIT_FAILURE;
+    closeDisks(disks, g.N);
+    free(disks);
+    return status;
+}
+
+// recreate one lost member from the survivors
+static int rebuildCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 5) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g;
+    int64_t missing; // index of the disk to recreate
+    g.layout = opts.layout;
+    g.N = argc - optind - 3;
+    char **diskPaths = &argv[3];
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &g.K) || parseSize(argv[2], &missing)
+     || raid5_geom_init(&g) != 0 || missing >= g.N) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    if (!disks) {
         perror("Failed to allocate memory for disk array");
-        free(inputData); // free memory for input data 
-        return EXIT_FAILURE; 
-    } 
-
-    for (int d = 0; d < N; d++) { // allocate memory for each disk
-        disks[d] = calloc(K, 1); // initialize each disk to zero
-        if (!disks[d]) { // error if memory allocation fails
-            perror("Failed to allocate memory for disk");
-            for (int i = 0; i < d; i++) { // free memory for disks
-                free(disks[i]);
-            }
-            free(disks); // free memory for disk array
-            free(inputData); // free memory for input data 
-            return EXIT_FAILURE; 
-        } 
-    }
-
-    int numDataBlocks = J / B; // number of data blocks in input data
-    int perStripe = N - 1; // number of data disks in each stripe
-
-    int currentBlock = 0; // track current data block index
-    while (currentBlock < numDataBlocks) { // while there are still data blocks to process
-        int stripe = currentBlock / perStripe; // calculate stripe index
-        int offsetInStripe = currentBlock % perStripe; // calculate offset in stripe
-
-        int parityDisk = (N - 1 - stripe % N + N) % N; // calculate parity disk for this stripe
-        int diskIndex = (parityDisk + 1 + offsetInStripe) % N; // calculate data disk index
-        int offsetInDisk = stripe * B; // calculate offset in disk
-
-        if (offsetInDisk >= K) break; // don't exceed disk size
-
-        memcpy(disks[diskIndex] + offsetInDisk, inputData +  (currentBlock * B), B); // copy data block to disk
-
-        if (offsetInStripe == perStripe - 1 || currentBlock == numDataBlocks - 1) { // if all data blocks in this stripe are filled
-            int stripeStartBlock =  (currentBlock / perStripe) * perStripe; // calculate start block of stripe
-            memset(disks[parityDisk] + offsetInDisk, 0, B); // clear parity block first
-            for (int i = 0; i < perStripe && stripeStartBlock + i < numDataBlocks; i++) { // iterate over each data block in the stripe
-                int dataDiskIndex = (parityDisk + 1 + i) % N; // calculate data disk index
-                for (int b = 0; b < B; b++) { // XOR this data block into the parity block
-                    disks[parityDisk][offsetInDisk + b] ^= disks[dataDiskIndex][offsetInDisk + b];
-                }
-            }
+        return EXIT_FAILURE;
+    }
+    int status = EXIT_FAILURE;
+    if (openDisks(disks, diskPaths, g.N, (int)missing, &opts, O_RDONLY, g.K) == 0) {
+        if (disk_create(&disks[missing], diskPaths[missing], !opts.binary, g.K) != 0) {
+            perror(diskPaths[missing]);
+        } else if (raid5_rebuild(&g, disks, (int)missing, opts.threads) == 0) {
+            status = EXIT_SUCCESS;
         }
-        currentBlock++; // increment current data block index
+    }
+    closeDisks(disks, g.N);
+    free(disks);
+    return status;
+}
+
+// print a logical byte range of the array to standard output
+static int readCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || argc - optind < 6) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g;
+    int64_t offset, length; // logical byte range to read
+    g.layout = opts.layout;
+    g.N = argc - optind - 4;
+    char **diskPaths = &argv[4];
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &g.K) || parseSize(argv[2], &offset)
+     || parseSize(argv[3], &length) || raid5_geom_init(&g) != 0 || opts.missing >= g.N
+     || offset > raid5_capacity(&g) || length > raid5_capacity(&g) - offset) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
     }
 
-    // write data to output files
-    for (int d = 0; d < N; d++) { // iterate over each disk
-        FILE *fout = fopen(diskPaths[d], "w"); // open disk file for writing
-        if (!fout) { 
-            perror(diskPaths[d]); 
-            continue; // error if file cannot be opened
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    unsigned char *buf = malloc(READ_STEP);
+    char *hexBuf = malloc(2 * READ_STEP);
+    if (!disks || !buf || !hexBuf) {
+        perror("Failed to allocate memory for read buffers");
+        free(disks);
+        free(buf);
+        free(hexBuf);
+        return EXIT_FAILURE;
+    }
+    int status = openDisks(disks, diskPaths, g.N, opts.missing, &opts, O_RDONLY, g.K) == 0
+               ? EXIT_SUCCESS : EXIT_FAILURE;
+    for (int64_t done = 0; status == EXIT_SUCCESS && done < length; done += READ_STEP) {
+        int64_t len = length - done < READ_STEP ? length - done : READ_STEP;
+        if (raid5_read(&g, disks, opts.missing, buf, len, offset + done) != 0) {
+            status = EXIT_FAILURE;
+            break;
+        }
+        const void *out = buf;
+        int64_t outLen = len;
+        if (!opts.binary) { // same hex pairs the encoder reads
+            hex_encode(buf, len, hexBuf);
+            out = hexBuf;
+            outLen = 2 * len;
         }
+        if ((int64_t)fwrite(out, 1, outLen, stdout) != outLen) {
+            perror("Failed to write output");
+            status = EXIT_FAILURE;
+        }
+    }
+    if (fflush(stdout) != 0) status = EXIT_FAILURE;
+    closeDisks(disks, g.N);
+    free(disks);
+    free(buf);
+    free(hexBuf);
+    return status;
+}
+
+// overwrite part of the array with the contents of a file
+static int updateCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 6) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g;
+    int64_t offset; // logical byte where the new data goes
+    char *inputPath = argv[3];
+    g.layout = opts.layout;
+    g.N = argc - optind - 4;
+    char **diskPaths = &argv[4];
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &g.K) || parseSize(argv[2], &offset)
+     || raid5_geom_init(&g) != 0 || offset > raid5_capacity(&g)) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *fin = fopen(inputPath, opts.binary ? "rb" : "r");
+    if (!fin) {
+        perror("Failed to open input file");
+        return EXIT_FAILURE;
+    }
+    fseeko(fin, 0, SEEK_END);
+    int64_t length = (int64_t)ftello(fin) / (opts.binary ? 1 : 2); // hex input uses two characters per byte
+    rewind(fin);
+    if (length > raid5_capacity(&g) - offset) {
+        fprintf(stderr, "Invalid parameters.\n");
+        fclose(fin);
+        return EXIT_FAILURE;
+    }
 
-        for (int b = 0; b < K; b++) { // write data to disk
-            fprintf(fout, "%02x", disks[d][b]); // write each byte as hex string
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    unsigned char *buf = malloc(UPDATE_STEP);
+    char *raw = malloc(2 * UPDATE_STEP);
+    if (!disks || !buf || !raw) {
+        perror("Failed to allocate memory for update buffers");
+        free(disks);
+        free(buf);
+        free(raw);
+        fclose(fin);
+        return EXIT_FAILURE;
+    }
+
+    // cut the input at stripe boundaries so whole stripes keep the full-stripe path
+    int64_t stripeBytes = (g.N - 1) * g.B;
+    int64_t step = UPDATE_STEP / stripeBytes * stripeBytes;
+    if (step == 0) step = UPDATE_STEP;
+    int status = openDisks(disks, diskPaths, g.N, -1, &opts, O_RDWR, g.K) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    for (int64_t pos = offset; status == EXIT_SUCCESS && pos < offset + length; ) {
+        int64_t next = (pos / step + 1) * step;
+        int64_t len = (next < offset + length ? next : offset + length) - pos;
+        int64_t charsPerByte = opts.binary ? 1 : 2;
+        int64_t got = (int64_t)fread(opts.binary ? (void *)buf : (void *)raw, 1, len * charsPerByte, fin);
+        int64_t bad = got != len * charsPerByte ? got / charsPerByte
+                    : opts.binary ? -1 : hex_decode(raw, buf, len);
+        if (bad >= 0) {
+            fprintf(stderr, "Error reading byte %" PRId64 "\n", pos - offset + bad);
+            status = EXIT_FAILURE;
+        } else if (raid5_update(&g, disks, buf, len, pos) != 0) {
+            status = EXIT_FAILURE;
         }
-        
-        fclose(fout); // close disk file
-        free(disks[d]); // free memory for disk
+        pos += len;
+    }
+    fclose(fin);
+    closeDisks(disks, g.N);
+    free(disks);
+    free(buf);
+    free(raw);
+    return status;
+}
+
+// record a checksum for every block of the array
+static int checksumCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 5) {
+        usage(prog);
+        return EXIT_FAILURE;
     }
+    argv += optind;
 
-    // free memory for input data and disks
+    raid5_geom_t g;
+    char *checksumPath = argv[2];
+    g.layout = opts.layout;
+    g.N = argc - optind - 3;
+    char **diskPaths = &argv[3];
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &g.K) || raid5_geom_init(&g) != 0) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    if (!disks) {
+        perror("Failed to allocate memory for disk array");
+        return EXIT_FAILURE;
+    }
+    int status = openDisks(disks, diskPaths, g.N, -1, &opts, O_RDONLY, g.K) == 0
+              && raid5_checksum(&g, disks, checksumPath, opts.threads) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    closeDisks(disks, g.N);
     free(disks);
-    free(inputData);
-    return EXIT_SUCCESS; // return success
+    return status;
+}
 
-}
\ No newline at end of file
+// check parity and, optionally, block checksums; mismatches go to standard output
+static int scrubCommand(const char *prog, int argc, char *argv[]) {
+    options_t opts;
+    if (parseOptions(argc, argv, &opts) != 0 || opts.missing >= 0 || argc - optind < 4) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g;
+    g.layout = opts.layout;
+    g.N = argc - optind - 2;
+    char **diskPaths = &argv[2];
+    if (parseSize(argv[0], &g.B) || parseSize(argv[1], &g.K) || raid5_geom_init(&g) != 0
+     || (opts.raid6 && g.N < 3)) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    disk_t *disks = malloc(g.N * sizeof(disk_t));
+    if (!disks) {
+        perror("Failed to allocate memory for disk array");
+        return EXIT_FAILURE;
+    }
+    raid5_scrub_stats_t stats;
+    int status = EXIT_FAILURE;
+    if (openDisks(disks, diskPaths, g.N, -1, &opts, O_RDONLY, g.K) == 0
+     && raid5_scrub(&g, disks, opts.raid6, opts.checksums, opts.threads, stdout, &stats) == 0) {
+        fprintf(stderr, "%" PRId64 " stripes checked, %" PRId64 " inconsistent, %" PRId64 " blocks with bad checksums\n",
+                stats.stripes, stats.badStripes, stats.badBlocks);
+        if (stats.badStripes == 0 && stats.badBlocks == 0) status = EXIT_SUCCESS;
+    }
+    fflush(stdout);
+    closeDisks(disks, g.N);
+    free(disks);
+    return status;
+}
+
+int main(int argc, char *argv[]) { // command line arguments, array of strings holding each
+    if (argc > 1 && strcmp(argv[1], "rebuild") == 0) {
+        return rebuildCommand(argv[0], argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "read") == 0) {
+        return readCommand(argv[0], argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "update") == 0) {
+        return updateCommand(argv[0], argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "checksum") == 0) {
+        return checksumCommand(argv[0], argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "scrub") == 0) {
+        return scrubCommand(argv[0], argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "reshape") == 0) {
+        return reshapeCommand(argv[0], argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "raid6") == 0) {
+        return raid6Command(argv[0], argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "raid6-rebuild") == 0) {
+        return raid6RebuildCommand(argv[0], argc - 1, argv + 1);
+    }
+    return encodeCommand(argv[0], argc, argv);
+}
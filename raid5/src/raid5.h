@@ -0,0 +1,132 @@
+#ifndef __RAID5_HEADER__
+#define __RAID5_HEADER__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "disk.h"
+
+#define RAID5_MAX_BLOCK (1 << 24) // largest supported block (chunk) size
+#define RAID5_MAX_DISKS 64
+
+// where parity and data go in each stripe, named as in Linux md
+enum {
+    RAID5_LEFT_SYMMETRIC, // default: parity rotates down from the last disk, data starts right after it
+    RAID5_LEFT_ASYMMETRIC, // parity rotates down from the last disk, data fills the other disks in order
+    RAID5_RIGHT_SYMMETRIC, // parity rotates up from the first disk, data starts right after it
+    RAID5_RIGHT_ASYMMETRIC, // parity rotates up from the first disk, data fills the other disks in order
+    RAID5_RAID4, // parity fixed on the last disk
+    RAID5_NUM_LAYOUTS
+};
+
+// array geometry shared by every mode
+typedef struct {
+    int64_t B; // block size in bytes
+    int64_t K; // size of each disk in bytes
+    int N; // number of disks; each stripe holds N-1 data blocks and one parity block
+    int layout; // one of the RAID5_* layouts above
+    // placement for one period of N stripes, filled in by raid5_geom_init
+    unsigned char parityMap[RAID5_MAX_DISKS];
+    unsigned char dataMap[RAID5_MAX_DISKS][RAID5_MAX_DISKS - 1];
+} raid5_geom_t;
+
+int raid5_geom_valid(const raid5_geom_t *g); // 1 if B, K, N and layout describe a usable array
+int raid5_geom_init(raid5_geom_t *g); // validate, then build the placement tables; 0 or -1
+int64_t raid5_capacity(const raid5_geom_t *g); // logical bytes the array can hold
+int raid5_layout_parse(const char *name); // -1 for unknown names
+const char *raid5_layout_name(int layout);
+
+static inline int raid5_parity_disk(const raid5_geom_t *g, int64_t stripe) {
+    return g->parityMap[stripe % g->N];
+}
+
+static inline int raid5_data_disk(const raid5_geom_t *g, int64_t stripe, int index) { // index in [0, N-1)
+    return g->dataMap[stripe % g->N][index];
+}
+
+// copy len logical bytes starting at off into buf; missing is a disk to
+// reconstruct on the fly instead of reading, or -1 when every disk is present
+int raid5_read(const raid5_geom_t *g, disk_t *disks, int missing, unsigned char *buf, int64_t len, int64_t off);
+
+// overwrite len logical bytes at off in place: partial stripes update parity
+// as P ^= old ^ new, stripes covered completely are written without reading
+int raid5_update(const raid5_geom_t *g, disk_t *disks, const unsigned char *buf, int64_t len, int64_t off);
+
+// lay out J bytes of input (raw, or two hex characters per byte) across freshly
+// created disks; threads > 1 encodes on a worker pool with one writer per disk
+int raid5_encode(const raid5_geom_t *g, disk_t *disks, FILE *input, int hexInput, int64_t J, int threads);
+
+// recreate disks[missing] as the XOR of every surviving member, window by window
+int raid5_rebuild(const raid5_geom_t *g, disk_t *disks, int missing, int threads);
+
+// grow the array from g->N to g->N + 1 members in place, stripe window by
+// stripe window; disks holds the old members followed by the new one, which
+// is created. Progress is kept in the checkpoint file so an interrupted
+// reshape resumes where it stopped; the file is removed once it completes
+int raid5_reshape(const raid5_geom_t *g, disk_t *disks, const char *checkpointPath);
+
+// RAID-6 keeps two parity blocks per stripe, so any two members can be lost:
+// P is the XOR of the N-2 data blocks and Q = sum of 2^i * D_i over GF(2^8).
+// P rotates like the left-symmetric RAID-5 parity, Q sits on the disk after
+// it and the data blocks follow Q. The layout field is ignored.
+static inline int raid6_p_disk(const raid5_geom_t *g, int64_t stripe) {
+    return (int)(g->N - 1 - stripe % g->N);
+}
+
+static inline int raid6_q_disk(const raid5_geom_t *g, int64_t stripe) {
+    return (raid6_p_disk(g, stripe) + 1) % g->N;
+}
+
+static inline int raid6_data_disk(const raid5_geom_t *g, int64_t stripe, int index) { // index in [0, N-2)
+    return (raid6_p_disk(g, stripe) + 2 + index) % g->N;
+}
+
+int64_t raid6_capacity(const raid5_geom_t *g); // logical bytes a RAID-6 array of this geometry holds
+
+// lay out J bytes of input with P and Q parity; same pipeline as raid5_encode
+int raid6_encode(const raid5_geom_t *g, disk_t *disks, FILE *input, int hexInput, int64_t J, int threads);
+
+// recreate disks[missing[0]] and, when count is 2, disks[missing[1]] from the
+// survivors; any pair of data, P and Q blocks can be recovered
+int raid6_rebuild(const raid5_geom_t *g, disk_t *disks, const int *missing, int count, int threads);
+
+// what raid5_scrub found
+typedef struct {
+    int64_t stripes; // stripes checked
+    int64_t badStripes; // stripes whose parity does not match their data
+    int64_t badBlocks; // blocks whose contents no longer match the recorded checksum
+} raid5_scrub_stats_t;
+
+// record a CRC32C for every block of every member in a sidecar file at path
+int raid5_checksum(const raid5_geom_t *g, disk_t *disks, const char *path, int threads);
+
+// recompute the parity of every stripe (P and Q when raid6 is set) and, given
+// the sidecar from raid5_checksum, every block's checksum, so a bad stripe can
+// be traced to the member that changed; each mismatch is written to report.
+// Returns -1 on I/O errors, otherwise 0 with the counts in stats
+int raid5_scrub(const raid5_geom_t *g, disk_t *disks, int raid6, const char *checksumPath, int threads,
+                FILE *report, raid5_scrub_stats_t *stats);
+
+// in-process block device over the member files with an LRU write-back stripe
+// cache; writes gather in the cache and each dirty stripe gets its parity
+// computed once when it is evicted or flushed
+typedef struct raid5 raid5_t;
+
+typedef struct {
+    int64_t hits, misses; // block accesses that found / did not find their data cached
+    int64_t writes; // raid5_pwrite calls
+    int64_t coalesced; // writes that landed on a stripe already waiting to be flushed
+    int64_t fullStripeWrites; // flushes where every data block was in the cache
+    int64_t reconstructWrites; // flushes that read the few missing blocks to write a full stripe
+    int64_t rmwWrites; // flushes that updated parity as P ^= old ^ new
+} raid5_stats_t;
+
+raid5_t *raid5_open(const raid5_geom_t *g, char **paths, int hex, int cacheStripes); // NULL with errno set
+int raid5_pread(raid5_t *r, void *buf, int64_t len, int64_t off);
+int raid5_pwrite(raid5_t *r, const void *buf, int64_t len, int64_t off);
+int raid5_flush(raid5_t *r); // write every dirty stripe back to the members
+int raid5_close(raid5_t *r); // flush, then release everything
+void raid5_get_stats(raid5_t *r, raid5_stats_t *stats);
+double raid5_hit_ratio(const raid5_stats_t *stats);
+
+#endif
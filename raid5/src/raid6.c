@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "gf256.h"
+#include "io.h"
+#include "raid5.h"
+#include "xor.h"
+
+#define RAID6_WINDOW (1 << 18) // bytes per disk handled by one worker step
+
+// shared state of one RAID-6 rebuild
+typedef struct {
+    const raid5_geom_t *g;
+    disk_t *disks;
+    int lost[RAID5_MAX_DISKS]; // 1 for members being recreated
+    int failed;
+    int64_t window, next; // stripes per window, first stripe of the next window to hand out
+    pthread_mutex_t lock;
+} raid6_rebuild_t;
+
+int64_t raid6_capacity(const raid5_geom_t *g) {
+    return g->K / g->B * (g->N - 2) * g->B;
+}
+
+static int64_t claimWindow(raid6_rebuild_t *r) {
+    pthread_mutex_lock(&r->lock);
+    int64_t first = -1;
+    if (!r->failed && r->next < r->g->K / r->g->B) {
+        first = r->next;
+        r->next += r->window;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return first;
+}
+
+static void setFailed(raid6_rebuild_t *r) {
+    pthread_mutex_lock(&r->lock);
+    r->failed = 1;
+    pthread_mutex_unlock(&r->lock);
+}
+
+// fill in the lost blocks of one stripe; region(d) is disk d's block, pp and qq are scratch
+static void recoverStripe(raid6_rebuild_t *r, unsigned char **region, int64_t stripe,
+                          const unsigned char *zero, unsigned char *pp, unsigned char *qq) {
+    const raid5_geom_t *g = r->g;
+    int64_t B = g->B;
+    int n = g->N - 2;
+    unsigned char *P = region[raid6_p_disk(g, stripe)], *Q = region[raid6_q_disk(g, stripe)];
+    int pLost = r->lost[raid6_p_disk(g, stripe)], qLost = r->lost[raid6_q_disk(g, stripe)];
+
+    const unsigned char *data[RAID5_MAX_DISKS];
+    int lostData[2], numLost = 0;
+    for (int i = 0; i < n; i++) {
+        int d = raid6_data_disk(g, stripe, i);
+        if (r->lost[d]) lostData[numLost++] = i;
+        data[i] = r->lost[d] ? zero : region[d];
+    }
+    gf256_gen_pq(data, n, pp, qq, B); // parity of the surviving data alone
+
+    if (numLost == 0) { // only parity was lost
+        if (pLost) memcpy(P, pp, B);
+        if (qLost) memcpy(Q, qq, B);
+    } else if (numLost == 1 && !pLost) { // D = P ^ P', then Q from scratch if needed
+        int a = lostData[0];
+        unsigned char *Da = region[raid6_data_disk(g, stripe, a)];
+        memcpy(Da, P, B);
+        xor_into(Da, pp, B);
+        if (qLost) {
+            memcpy(Q, qq, B);
+            gf256_mul_into(Q, Da, gf256_pow2(a), B);
+        }
+    } else if (numLost == 1) { // D = (Q ^ Q') / 2^a, then P = P' ^ D
+        int a = lostData[0];
+        unsigned char *Da = region[raid6_data_disk(g, stripe, a)];
+        xor_into(qq, Q, B);
+        memset(Da, 0, B);
+        gf256_mul_into(Da, qq, gf256_pow2(-a), B);
+        memcpy(P, pp, B);
+        xor_into(P, Da, B);
+    } else { // two data blocks: solve Da ^ Db = P ^ P' and 2^a Da ^ 2^b Db = Q ^ Q'
+        int a = lostData[0], b = lostData[1];
+        unsigned char *Da = region[raid6_data_disk(g, stripe, a)], *Db = region[raid6_data_disk(g, stripe, b)];
+        xor_into(pp, P, B);
+        xor_into(qq, Q, B);
+        unsigned char gba = gf256_pow2(b - a);
+        unsigned char denom = gf256_inv(gba ^ 1);
+        memset(Da, 0, B);
+        gf256_mul_into(Da, pp, gf256_mul(gba, denom), B);
+        gf256_mul_into(Da, qq, gf256_mul(gf256_pow2(-a), denom), B);
+        memcpy(Db, pp, B);
+        xor_into(Db, Da, B);
+    }
+}
+
+static void *rebuildWorker(void *arg) {
+    raid6_rebuild_t *r = arg;
+    const raid5_geom_t *g = r->g;
+    int N = g->N;
+    int64_t B = g->B, span = r->window * B;
+    unsigned char *buf = io_alloc((size_t)(N * span));
+    unsigned char *scratch = malloc((size_t)(3 * B)); // zero block, P', Q'
+    io_t *io = io_open(N);
+    if (!buf || !scratch || !io) {
+        perror("Failed to allocate rebuild buffers");
+        setFailed(r);
+    } else {
+        memset(scratch, 0, B);
+    }
+
+    int64_t first;
+    while (buf && scratch && io && (first = claimWindow(r)) >= 0) {
+        int64_t count = g->K / B - first < r->window ? g->K / B - first : r->window;
+        int ok = 1;
+        for (int d = 0; d < N && ok; d++) { // every survivor is read at once
+            if (r->lost[d]) continue;
+            ok = disk_queue_read(io, &r->disks[d], buf + d * span, count * B, first * B) == 0;
+        }
+        if (io_wait(io) != 0 || !ok) {
+            perror("Failed to read the surviving disks");
+            ok = 0;
+        }
+        for (int64_t s = 0; s < count && ok; s++) {
+            unsigned char *region[RAID5_MAX_DISKS];
+            for (int d = 0; d < N; d++) {
+                region[d] = buf + d * span + s * B;
+            }
+            recoverStripe(r, region, first + s, scratch, scratch + B, scratch + 2 * B);
+        }
+        for (int d = 0; d < N && ok; d++) {
+            if (!r->lost[d]) continue;
+            if (disk_write_sparse(&r->disks[d], buf + d * span, count * B, first * B, B) != 0) {
+                perror(r->disks[d].path);
+                ok = 0;
+            }
+        }
+        if (!ok) setFailed(r);
+    }
+    io_close(io);
+    free(buf);
+    free(scratch);
+    return NULL;
+}
+
+int raid6_rebuild(const raid5_geom_t *g, disk_t *disks, const int *missing, int count, int threads) {
+    raid6_rebuild_t r = {0};
+    r.g = g;
+    r.disks = disks;
+    for (int i = 0; i < count; i++) {
+        r.lost[missing[i]] = 1;
+    }
+    r.window = RAID6_WINDOW / g->B; // whole stripes so every block of a stripe is in memory at once
+    if (r.window < 1) r.window = 1;
+    pthread_mutex_init(&r.lock, NULL);
+
+    int64_t numWindows = (g->K / g->B + r.window - 1) / r.window;
+    if (threads > numWindows) threads = (int)numWindows;
+    if (threads <= 1) {
+        rebuildWorker(&r);
+    } else {
+        pthread_t *workers = malloc(threads * sizeof(pthread_t));
+        if (!workers) {
+            perror("Failed to allocate rebuild threads");
+            pthread_mutex_destroy(&r.lock);
+            return -1;
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_create(&workers[i], NULL, rebuildWorker, &r);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
+    }
+    pthread_mutex_destroy(&r.lock);
+    return r.failed ? -1 : 0;
+}
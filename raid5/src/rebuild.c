@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "io.h"
+#include "raid5.h"
+#include "xor.h"
+
+#define REBUILD_WINDOW (1 << 20) // bytes per disk handled by one worker step
+
+// shared state of one rebuild
+typedef struct {
+    const raid5_geom_t *g;
+    disk_t *disks;
+    int missing, failed;
+    int64_t window, next; // bytes per window, offset of the next window to hand out
+    pthread_mutex_t lock;
+} rebuild_t;
+
+// hand out windows in disk order so every worker keeps reading close to the others
+static int64_t claimWindow(rebuild_t *r) {
+    pthread_mutex_lock(&r->lock);
+    int64_t off = -1;
+    if (!r->failed && r->next < r->g->K) {
+        off = r->next;
+        r->next += r->window;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return off;
+}
+
+static void setFailed(rebuild_t *r) {
+    pthread_mutex_lock(&r->lock);
+    r->failed = 1;
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void *rebuildWorker(void *arg) {
+    rebuild_t *r = arg;
+    int N = r->g->N;
+    unsigned char *buf = io_alloc((size_t)(N * r->window)); // one region per disk
+    io_t *io = io_open(N - 1);
+    if (!buf || !io) {
+        perror("Failed to allocate rebuild buffers");
+        setFailed(r);
+    }
+
+    int64_t off;
+    while (buf && io && (off = claimWindow(r)) >= 0) {
+        int64_t len = r->g->K - off < r->window ? r->g->K - off : r->window;
+        int first = -1, ok = 1; // first survivor, which the others are XORed into
+        for (int d = 0; d < N && ok; d++) { // every survivor is read at once
+            if (d == r->missing) continue;
+            if (first < 0) first = d;
+            ok = disk_queue_read(io, &r->disks[d], buf + d * r->window, len, off) == 0;
+        }
+        if (io_wait(io) != 0 || !ok) { // always drain before the buffer is reused
+            perror("Failed to read the surviving disks");
+            setFailed(r);
+            break;
+        }
+        unsigned char *acc = buf + first * r->window;
+        for (int d = first + 1; d < N; d++) { // every block of a stripe XORs to zero, so the survivors XOR to the lost one
+            if (d != r->missing) xor_into(acc, buf + d * r->window, len);
+        }
+        if (disk_write_sparse(&r->disks[r->missing], acc, len, off, r->g->B) != 0) {
+            perror(r->disks[r->missing].path);
+            setFailed(r);
+        }
+    }
+    io_close(io);
+    free(buf);
+    return NULL;
+}
+
+int raid5_rebuild(const raid5_geom_t *g, disk_t *disks, int missing, int threads) {
+    rebuild_t r = {0};
+    r.g = g;
+    r.disks = disks;
+    r.missing = missing;
+    r.window = REBUILD_WINDOW / g->B * g->B; // whole blocks so zero blocks can stay holes
+    if (r.window < g->B) r.window = g->B;
+    pthread_mutex_init(&r.lock, NULL);
+
+    int64_t numWindows = (g->K + r.window - 1) / r.window;
+    if (threads > numWindows) threads = (int)numWindows;
+    if (threads <= 1) {
+        rebuildWorker(&r);
+    } else {
+        pthread_t *workers = malloc(threads * sizeof(pthread_t));
+        if (!workers) {
+            perror("Failed to allocate rebuild threads");
+            pthread_mutex_destroy(&r.lock);
+            return -1;
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_create(&workers[i], NULL, rebuildWorker, &r);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
+    }
+    pthread_mutex_destroy(&r.lock);
+    return r.failed ? -1 : 0;
+}
@@ -0,0 +1,377 @@
+#define _GNU_SOURCE // getopt and clock_nanosleep under -std=c99
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "queue.h"
+#include "raid5.h"
+
+// replay a block I/O trace against an array through the cached raid5_t handle.
+// Trace lines are "timestamp_us offset length R|W"; blank lines and lines
+// starting with # are skipped. Offsets past the end of the array wrap around.
+
+// one traced request
+typedef struct {
+    double time; // seconds since the start of the trace
+    int64_t off, len;
+    int write;
+} op_t;
+
+// everything the replay threads share
+typedef struct {
+    raid5_t *array;
+    op_t *ops;
+    int64_t count, maxLen;
+    double *latency; // seconds per op, indexed like ops
+    double start, speed; // wall clock at time 0, trace seconds per wall second
+    int64_t next; // closed loop: next op to issue
+    int failed;
+    pthread_mutex_t lock;
+    queue_t pending; // open loop: ops whose time has come
+} replay_t;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+static void sleepUntil(double when) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)when;
+    ts.tv_nsec = (long)((when - (double)ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-b] [-l layout] [-n] [-m open|closed] [-c concurrency] [-x speed] [-C cache_stripes]\n"
+                    "           B K trace_file disk0 disk1 ... diskN-1\n", prog);
+    fprintf(stderr, "       %s gen [-n ops] [-r read_percent] [-s min_kib,max_kib] [-q sequential_percent]\n"
+                    "           [-i iops] [-S seed] capacity\n", prog);
+}
+
+// ---- trace input ----
+
+static int loadTrace(const char *path, int64_t capacity, op_t **opsOut, int64_t *countOut, int64_t *maxLenOut) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    int64_t count = 0, cap = 1024, maxLen = 1, lineNo = 0;
+    op_t *ops = malloc(cap * sizeof(op_t));
+    char line[256];
+    while (ops && fgets(line, sizeof(line), f)) {
+        lineNo++;
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+        double us;
+        long long off, len;
+        char kind;
+        if (sscanf(p, "%lf %lld %lld %c", &us, &off, &len, &kind) != 4 || off < 0 || len < 1
+         || (kind != 'R' && kind != 'W' && kind != 'r' && kind != 'w')) {
+            fprintf(stderr, "%s:%" PRId64 ": expected \"timestamp_us offset length R|W\"\n", path, lineNo);
+            free(ops);
+            fclose(f);
+            return -1;
+        }
+        if (count == cap) {
+            op_t *grown = realloc(ops, 2 * cap * sizeof(op_t));
+            if (!grown) {
+                free(ops);
+                ops = NULL;
+                break;
+            }
+            ops = grown;
+            cap *= 2;
+        }
+        op_t *op = &ops[count++];
+        op->time = us / 1e6;
+        op->len = len < capacity ? len : capacity;
+        op->off = off % capacity; // traces from bigger volumes wrap around
+        if (op->off + op->len > capacity) op->off = capacity - op->len;
+        op->write = kind == 'W' || kind == 'w';
+        if (op->len > maxLen) maxLen = op->len;
+    }
+    int readError = ferror(f);
+    fclose(f);
+    if (!ops || readError) {
+        perror(path);
+        free(ops);
+        return -1;
+    }
+    *opsOut = ops;
+    *countOut = count;
+    *maxLenOut = maxLen;
+    return 0;
+}
+
+// ---- replay ----
+
+static int runOp(replay_t *r, const op_t *op, unsigned char *buf) {
+    int status = op->write ? raid5_pwrite(r->array, buf, op->len, op->off)
+                           : raid5_pread(r->array, buf, op->len, op->off);
+    if (status != 0) {
+        pthread_mutex_lock(&r->lock);
+        if (!r->failed) perror(op->write ? "raid5_pwrite" : "raid5_pread");
+        r->failed = 1;
+        pthread_mutex_unlock(&r->lock);
+    }
+    return status;
+}
+
+static unsigned char *allocPattern(int64_t len) {
+    unsigned char *buf = malloc(len);
+    for (int64_t i = 0; buf && i < len; i++) {
+        buf[i] = (unsigned char)(i * 131 + 7); // written data only needs to be non-trivial
+    }
+    return buf;
+}
+
+// closed loop: each thread issues its next op as soon as the last one finishes
+static void *closedWorker(void *arg) {
+    replay_t *r = arg;
+    unsigned char *buf = allocPattern(r->maxLen);
+    for (;;) {
+        pthread_mutex_lock(&r->lock);
+        int64_t i = !buf || r->failed ? r->count : r->next++;
+        pthread_mutex_unlock(&r->lock);
+        if (i >= r->count) break;
+        double t0 = now();
+        if (runOp(r, &r->ops[i], buf) != 0) break;
+        r->latency[i] = now() - t0;
+    }
+    free(buf);
+    return NULL;
+}
+
+// open loop: ops are released on schedule and latency runs from the scheduled
+// time, so time spent queued behind a slow array counts
+static void *openWorker(void *arg) {
+    replay_t *r = arg;
+    unsigned char *buf = allocPattern(r->maxLen);
+    op_t *op;
+    while ((op = queue_pop(&r->pending)) != NULL) {
+        if (!buf || runOp(r, op, buf) != 0) continue; // keep draining so the dispatcher never blocks
+        r->latency[op - r->ops] = now() - (r->start + op->time / r->speed);
+    }
+    free(buf);
+    return NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double *sorted, int64_t n, double p) {
+    int64_t i = (int64_t)ceil(p / 100.0 * n) - 1;
+    return sorted[i < 0 ? 0 : i >= n ? n - 1 : i];
+}
+
+static void report(const replay_t *r, double elapsed) {
+    int64_t bytes = 0, reads = 0;
+    for (int64_t i = 0; i < r->count; i++) {
+        bytes += r->ops[i].len;
+        reads += !r->ops[i].write;
+    }
+    double *sorted = malloc(r->count * sizeof(double));
+    if (!sorted) return;
+    memcpy(sorted, r->latency, r->count * sizeof(double));
+    qsort(sorted, r->count, sizeof(double), compareDoubles);
+
+    raid5_stats_t stats;
+    raid5_get_stats(r->array, &stats);
+    printf("ops         %" PRId64 " (%" PRId64 " reads, %" PRId64 " writes)\n", r->count, reads, r->count - reads);
+    printf("elapsed     %.3f s\n", elapsed);
+    printf("IOPS        %.0f\n", r->count / elapsed);
+    printf("throughput  %.2f MB/s\n", bytes / elapsed / 1e6);
+    printf("latency     p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+           1e6 * percentile(sorted, r->count, 50), 1e6 * percentile(sorted, r->count, 99),
+           1e6 * percentile(sorted, r->count, 99.9), 1e6 * sorted[r->count - 1]);
+    printf("cache       %.1f%% hits, %" PRId64 " full-stripe, %" PRId64 " reconstruct, %" PRId64 " read-modify-write flushes\n",
+           100.0 * raid5_hit_ratio(&stats), stats.fullStripeWrites, stats.reconstructWrites, stats.rmwWrites);
+    free(sorted);
+}
+
+static int replayCommand(const char *prog, int argc, char *argv[]) {
+    int binary = 0, fresh = 0, closed = 1, concurrency = 1, cacheStripes = 64, layout = RAID5_LEFT_SYMMETRIC, opt;
+    double speed = 1.0;
+    while ((opt = getopt(argc, argv, "bl:nm:c:x:C:")) != -1) {
+        if (opt == 'b') binary = 1;
+        else if (opt == 'l') layout = raid5_layout_parse(optarg);
+        else if (opt == 'n') fresh = 1;
+        else if (opt == 'm') closed = strcmp(optarg, "closed") == 0 ? 1 : strcmp(optarg, "open") == 0 ? 0 : -1;
+        else if (opt == 'c') concurrency = atoi(optarg);
+        else if (opt == 'x') speed = atof(optarg);
+        else if (opt == 'C') cacheStripes = atoi(optarg);
+        else {
+            usage(prog);
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind < 5 || layout < 0 || closed < 0 || concurrency < 1 || speed <= 0 || cacheStripes < 1) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+    argv += optind;
+
+    raid5_geom_t g;
+    g.layout = layout;
+    g.N = argc - optind - 3;
+    char **paths = &argv[3];
+    char *end1, *end2;
+    g.B = strtoll(argv[0], &end1, 10);
+    g.K = strtoll(argv[1], &end2, 10);
+    if (*end1 != '\0' || *end2 != '\0' || raid5_geom_init(&g) != 0) {
+        fprintf(stderr, "Invalid parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (fresh) { // start from an all-zero array, which is consistent under every layout
+        for (int d = 0; d < g.N; d++) {
+            disk_t disk;
+            if (disk_create(&disk, paths[d], !binary, g.K) != 0
+             || (!binary && disk_write_zeros(&disk, 0, g.K) != 0)) {
+                perror(paths[d]);
+                return EXIT_FAILURE;
+            }
+            disk_close(&disk);
+        }
+    }
+
+    replay_t r;
+    memset(&r, 0, sizeof(r));
+    r.speed = speed;
+    if (loadTrace(argv[2], raid5_capacity(&g), &r.ops, &r.count, &r.maxLen) != 0) return EXIT_FAILURE;
+    if (r.count == 0) {
+        fprintf(stderr, "%s: trace is empty\n", argv[2]);
+        free(r.ops);
+        return EXIT_FAILURE;
+    }
+    r.latency = calloc(r.count, sizeof(double));
+    r.array = raid5_open(&g, paths, !binary, cacheStripes);
+    pthread_t *threads = malloc(concurrency * sizeof(pthread_t));
+    if (!r.latency || !r.array || !threads) {
+        perror(r.array ? "Failed to allocate replay buffers" : "raid5_open");
+        if (r.array) raid5_close(r.array);
+        free(r.ops);
+        free(r.latency);
+        free(threads);
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&r.lock, NULL);
+
+    r.start = now();
+    if (closed) {
+        for (int i = 0; i < concurrency; i++) {
+            pthread_create(&threads[i], NULL, closedWorker, &r);
+        }
+    } else {
+        queue_init(&r.pending, (int)(r.count < (1 << 20) ? r.count : 1 << 20));
+        for (int i = 0; i < concurrency; i++) {
+            pthread_create(&threads[i], NULL, openWorker, &r);
+        }
+        for (int64_t i = 0; i < r.count && !r.failed; i++) { // release each op at its timestamp
+            sleepUntil(r.start + r.ops[i].time / r.speed);
+            queue_push(&r.pending, &r.ops[i]);
+        }
+        queue_close(&r.pending);
+    }
+    for (int i = 0; i < concurrency; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now() - r.start;
+    if (!closed) queue_destroy(&r.pending);
+
+    if (!r.failed) report(&r, elapsed);
+    double flushStart = now();
+    int status = raid5_close(r.array) == 0 && !r.failed ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (status == EXIT_SUCCESS) printf("final flush %.3f s\n", now() - flushStart);
+    pthread_mutex_destroy(&r.lock);
+    free(r.ops);
+    free(r.latency);
+    free(threads);
+    return status;
+}
+
+// ---- synthetic traces ----
+
+static uint64_t rngState = 88172645463325252ULL;
+
+static uint64_t nextRandom(void) { // xorshift64
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+static double uniform(void) {
+    return (nextRandom() >> 11) * (1.0 / 9007199254740992.0); // [0, 1)
+}
+
+// mixed random and sequential requests with Poisson arrivals
+static int genCommand(const char *prog, int argc, char *argv[]) {
+    long long count = 10000, capacity;
+    int readPercent = 70, seqPercent = 20, minKiB = 4, maxKiB = 64, opt;
+    double iops = 1000;
+    while ((opt = getopt(argc, argv, "n:r:s:q:i:S:")) != -1) {
+        if (opt == 'n') count = atoll(optarg);
+        else if (opt == 'r') readPercent = atoi(optarg);
+        else if (opt == 's' && sscanf(optarg, "%d,%d", &minKiB, &maxKiB) == 2) continue;
+        else if (opt == 'q') seqPercent = atoi(optarg);
+        else if (opt == 'i') iops = atof(optarg);
+        else if (opt == 'S') rngState = strtoull(optarg, NULL, 10) * 0x9e3779b97f4a7c15ULL + 1;
+        else {
+            usage(prog);
+            return EXIT_FAILURE;
+        }
+    }
+    char *end;
+    if (argc - optind != 1 || (capacity = strtoll(argv[optind], &end, 10)) < 1 || *end != '\0' || count < 1
+     || readPercent < 0 || readPercent > 100 || seqPercent < 0 || seqPercent > 100 || iops <= 0
+     || minKiB < 1 || maxKiB < minKiB || (long long)maxKiB * 1024 > capacity) {
+        usage(prog);
+        return EXIT_FAILURE;
+    }
+
+    // request sizes are powers of two between the bounds, like most block traces
+    int sizes[32], numSizes = 0;
+    for (int kib = 1; kib <= maxKiB && numSizes < 32; kib *= 2) {
+        if (kib >= minKiB) sizes[numSizes++] = kib;
+    }
+    if (numSizes == 0) sizes[numSizes++] = minKiB;
+
+    printf("# timestamp_us offset length R|W\n");
+    double t = 0;
+    long long lastEnd = 0;
+    for (long long i = 0; i < count; i++) {
+        long long len = (long long)sizes[nextRandom() % numSizes] * 1024;
+        long long off;
+        if ((int)(nextRandom() % 100) < seqPercent && lastEnd + len <= capacity) {
+            off = lastEnd; // continue the previous request
+        } else {
+            off = (long long)(nextRandom() % (uint64_t)((capacity - len) / 4096 + 1)) * 4096;
+        }
+        lastEnd = off + len;
+        char kind = (int)(nextRandom() % 100) < readPercent ? 'R' : 'W';
+        printf("%.0f %lld %lld %c\n", t * 1e6, off, len, kind);
+        t += -log(1.0 - uniform()) / iops; // exponential gaps
+    }
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "gen") == 0) {
+        return genCommand(argv[0], argc - 1, argv + 1);
+    }
+    return replayCommand(argv[0], argc, argv);
+}
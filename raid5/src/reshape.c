@@ -0,0 +1,236 @@
+#define _GNU_SOURCE // pread, pwrite and fdatasync under -std=c99
+#define _FILE_OFFSET_BITS 64
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "crc32c.h"
+#include "disk.h"
+#include "raid5.h"
+#include "xor.h"
+
+#define RESHAPE_WINDOW (1 << 20) // bytes per member rewritten per step
+#define CHECKPOINT_MAGIC "R5RESHAP"
+
+// checkpoint file: this header, then a copy of the data of the window being rewritten
+typedef struct {
+    char magic[8];
+    int64_t B, K, N, layout; // geometry before the reshape
+    int64_t next; // new stripes before this one are written and synced
+    int64_t backupFirst, backupLen; // window saved after the header: first new stripe and data bytes, len 0 for none
+    uint32_t backupCrc; // CRC32C of the saved data
+    uint32_t headerCrc; // CRC32C of every field above, so a torn header is noticed
+} checkpoint_t;
+
+static int saveCheckpoint(int fd, checkpoint_t *ck) {
+    ck->headerCrc = crc32c(0, ck, offsetof(checkpoint_t, headerCrc));
+    return full_pwrite(fd, ck, sizeof(*ck), 0) == 0 && fdatasync(fd) == 0 ? 0 : -1;
+}
+
+static int syncDisks(disk_t *disks, int N) {
+    for (int d = 0; d < N; d++) {
+        if (disk_sync(&disks[d]) != 0) {
+            perror(disks[d].path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// lay the window's data out in the new geometry and write every member
+static int writeWindow(const raid5_geom_t *ng, disk_t *disks, const unsigned char *data, unsigned char *stripes,
+                       int64_t first, int64_t count, int64_t window, int64_t totalBlocks) {
+    int N = ng->N, perStripe = N - 1;
+    int64_t B = ng->B;
+    memset(stripes, 0, (size_t)(N * window * B)); // blocks past the end of the data stay zero
+    for (int64_t s = 0; s < count; s++) {
+        int64_t stripe = first + s;
+        unsigned char *parity = stripes + (raid5_parity_disk(ng, stripe) * window + s) * B;
+        for (int i = 0; i < perStripe && stripe * perStripe + i < totalBlocks; i++) {
+            unsigned char *block = stripes + (raid5_data_disk(ng, stripe, i) * window + s) * B;
+            memcpy(block, data + (s * perStripe + i) * B, B);
+            xor_into(parity, block, B);
+        }
+    }
+    for (int d = 0; d < N; d++) {
+        if (disk_write(&disks[d], stripes + d * window * B, count * B, first * B) != 0) {
+            perror(disks[d].path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// open the checkpoint of an interrupted reshape, or start a new one and create the new member
+static int openCheckpoint(const raid5_geom_t *g, disk_t *disks, const char *path, checkpoint_t *ck) {
+    int fd = open(path, O_RDWR);
+    if (fd >= 0) {
+        if (full_pread(fd, ck, sizeof(*ck), 0) != 0 || memcmp(ck->magic, CHECKPOINT_MAGIC, sizeof(ck->magic)) != 0
+         || ck->headerCrc != crc32c(0, ck, offsetof(checkpoint_t, headerCrc))) {
+            fprintf(stderr, "%s: not a valid reshape checkpoint\n", path);
+            close(fd);
+            return -1;
+        }
+        if (ck->B != g->B || ck->K != g->K || ck->N != g->N || ck->layout != g->layout) {
+            fprintf(stderr, "%s: checkpoint belongs to a different array\n", path);
+            close(fd);
+            return -1;
+        }
+        disk_t *added = &disks[g->N];
+        if (disk_open(added, added->path, added->hex, O_RDWR) != 0) {
+            perror(added->path);
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    if (errno != ENOENT) {
+        perror(path);
+        return -1;
+    }
+
+    // new member first: a crash before the checkpoint exists simply starts over
+    disk_t *added = &disks[g->N];
+    if (disk_create(added, added->path, added->hex, g->K) != 0 || disk_sync(added) != 0) {
+        perror(added->path);
+        return -1;
+    }
+    memset(ck, 0, sizeof(*ck));
+    memcpy(ck->magic, CHECKPOINT_MAGIC, sizeof(ck->magic));
+    ck->B = g->B;
+    ck->K = g->K;
+    ck->N = g->N;
+    ck->layout = g->layout;
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 || saveCheckpoint(fd, ck) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int raid5_reshape(const raid5_geom_t *g, disk_t *disks, const char *checkpointPath) {
+    raid5_geom_t ng = *g; // the grown array
+    ng.N = g->N + 1;
+    if (raid5_geom_init(&ng) != 0) {
+        errno = EINVAL;
+        perror("Cannot add a disk to this array");
+        return -1;
+    }
+    int oldPer = g->N - 1, newPer = ng.N - 1;
+    int64_t B = g->B;
+    int64_t totalBlocks = g->K / B * oldPer; // every block of the old array moves, used or not
+    int64_t newStripes = (totalBlocks + newPer - 1) / newPer;
+    int64_t window = RESHAPE_WINDOW / B;
+    if (window < 1) window = 1;
+
+    checkpoint_t ck;
+    int fd = openCheckpoint(g, disks, checkpointPath, &ck);
+    if (fd < 0) return -1;
+    unsigned char *data = malloc((size_t)(newPer * window * B));
+    unsigned char *stripes = malloc((size_t)(ng.N * window * B));
+    int status = data && stripes ? 0 : -1;
+    if (status != 0) perror("Failed to allocate reshape buffers");
+
+    // Stripes are rewritten front to back. New stripe s only overwrites old
+    // stripe s, whose data sits at or before logical block s * newPer, so a
+    // write is safe once every window reading that old stripe is recorded as
+    // done. Windows whose writes land on their own source are copied into the
+    // checkpoint first and replayed from there after a crash.
+    for (int64_t first = ck.next; status == 0 && first < newStripes; ) {
+        int64_t count = newStripes - first < window ? newStripes - first : window;
+        int64_t end = first + count;
+        int64_t lastBlock = end * newPer < totalBlocks ? end * newPer : totalBlocks;
+        int64_t len = (lastBlock - first * newPer) * B;
+
+        int replay = ck.backupLen > 0 && ck.backupFirst == first;
+        if (replay) {
+            if (ck.backupLen != len || full_pread(fd, data, len, sizeof(ck)) != 0
+             || crc32c(0, data, len) != ck.backupCrc) {
+                fprintf(stderr, "%s: saved window is damaged\n", checkpointPath);
+                status = -1;
+                break;
+            }
+        } else if (raid5_read(g, disks, -1, data, len, first * newPer * B) != 0) {
+            perror("Failed to read the array");
+            status = -1;
+            break;
+        }
+
+        if (!replay && end > ck.next * newPer / oldPer) { // would overwrite source not yet recorded as consumed
+            if (ck.next < first) {
+                if (syncDisks(disks, ng.N) != 0) {
+                    status = -1;
+                    break;
+                }
+                ck.next = first;
+                ck.backupLen = 0;
+                if (saveCheckpoint(fd, &ck) != 0) {
+                    perror(checkpointPath);
+                    status = -1;
+                    break;
+                }
+            }
+            if (end > first * newPer / oldPer) { // this window overwrites part of its own source
+                ck.backupFirst = first;
+                ck.backupLen = len;
+                ck.backupCrc = crc32c(0, data, len);
+                if (full_pwrite(fd, data, len, sizeof(ck)) != 0 || fdatasync(fd) != 0 || saveCheckpoint(fd, &ck) != 0) {
+                    perror(checkpointPath);
+                    status = -1;
+                    break;
+                }
+            }
+        }
+
+        if (writeWindow(&ng, disks, data, stripes, first, count, window, totalBlocks) != 0) {
+            status = -1;
+            break;
+        }
+        if (ck.backupLen > 0) { // the saved copy is only dropped once the window is durable
+            ck.next = end;
+            ck.backupLen = 0;
+            if (syncDisks(disks, ng.N) != 0) {
+                status = -1;
+                break;
+            }
+            if (saveCheckpoint(fd, &ck) != 0) {
+                perror(checkpointPath);
+                status = -1;
+                break;
+            }
+        }
+        first = end;
+    }
+
+    // stripes past the data now hold stale copies; zero them so their parity holds again
+    if (status == 0 && ck.next < newStripes) {
+        ck.next = newStripes;
+        ck.backupLen = 0;
+        status = syncDisks(disks, ng.N);
+        if (status == 0 && saveCheckpoint(fd, &ck) != 0) {
+            perror(checkpointPath);
+            status = -1;
+        }
+    }
+    for (int d = 0; status == 0 && d < ng.N; d++) {
+        if (disk_write_zeros(&disks[d], newStripes * B, g->K - newStripes * B) != 0) {
+            perror(disks[d].path);
+            status = -1;
+        }
+    }
+    if (status == 0) status = syncDisks(disks, ng.N);
+    close(fd);
+    if (status == 0 && unlink(checkpointPath) != 0) {
+        perror(checkpointPath);
+        status = -1;
+    }
+    free(data);
+    free(stripes);
+    return status;
+}
@@ -0,0 +1,247 @@
+#define _GNU_SOURCE // pread and pwrite under -std=c99
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "crc32c.h"
+#include "disk.h"
+#include "gf256.h"
+#include "io.h"
+#include "raid5.h"
+#include "xor.h"
+
+#define SCRUB_WINDOW (1 << 20) // bytes per disk handled by one worker step
+#define SIDECAR_MAGIC "R5CRC32C"
+
+// checksum file: this header, then one CRC32C per block at index stripe * N + disk
+typedef struct {
+    char magic[8];
+    int64_t B, K, N;
+} sidecar_header_t;
+
+// shared state of one checksum or scrub pass
+typedef struct {
+    const raid5_geom_t *g;
+    disk_t *disks;
+    int raid6; // check P and Q instead of plain XOR parity
+    int writeChecksums; // 1 to fill the sidecar, 0 to scrub against it
+    int sidecar; // checksum file descriptor, -1 for none
+    const char *sidecarPath;
+    FILE *report;
+    raid5_scrub_stats_t stats;
+    int failed;
+    int64_t window, next; // stripes per window, first stripe of the next window to hand out
+    pthread_mutex_t lock;
+} scrub_t;
+
+static int64_t claimWindow(scrub_t *s) {
+    pthread_mutex_lock(&s->lock);
+    int64_t first = -1;
+    if (!s->failed && s->next < s->g->K / s->g->B) {
+        first = s->next;
+        s->next += s->window;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return first;
+}
+
+static void setFailed(scrub_t *s) {
+    pthread_mutex_lock(&s->lock);
+    s->failed = 1;
+    pthread_mutex_unlock(&s->lock);
+}
+
+// compare one window against its parity and recorded checksums and add up what failed
+static void checkWindow(scrub_t *s, unsigned char *buf, int64_t span, const uint32_t *crcs, const uint32_t *expected,
+                        int64_t first, int64_t count, unsigned char *pp, unsigned char *qq) {
+    const raid5_geom_t *g = s->g;
+    int N = g->N;
+    int64_t B = g->B, badStripes = 0, badBlocks = 0;
+
+    if (!s->raid6) { // the N blocks of a consistent stripe XOR to zero, whatever the layout
+        for (int d = 1; d < N; d++) {
+            xor_into(buf, buf + d * span, count * B);
+        }
+    }
+    for (int64_t i = 0; i < count; i++) {
+        int64_t stripe = first + i;
+        int bad;
+        if (s->raid6) {
+            const unsigned char *data[RAID5_MAX_DISKS];
+            for (int k = 0; k < N - 2; k++) {
+                data[k] = buf + raid6_data_disk(g, stripe, k) * span + i * B;
+            }
+            gf256_gen_pq(data, N - 2, pp, qq, B);
+            int badP = memcmp(pp, buf + raid6_p_disk(g, stripe) * span + i * B, B) != 0;
+            int badQ = memcmp(qq, buf + raid6_q_disk(g, stripe) * span + i * B, B) != 0;
+            bad = badP || badQ;
+            if (bad) {
+                pthread_mutex_lock(&s->lock);
+                fprintf(s->report, "stripe %" PRId64 ": %s mismatch\n", stripe, badP && badQ ? "P and Q" : badP ? "P" : "Q");
+                pthread_mutex_unlock(&s->lock);
+            }
+        } else {
+            bad = !is_zero(buf + i * B, B);
+            if (bad) {
+                pthread_mutex_lock(&s->lock);
+                fprintf(s->report, "stripe %" PRId64 ": parity mismatch\n", stripe);
+                pthread_mutex_unlock(&s->lock);
+            }
+        }
+        badStripes += bad;
+        for (int d = 0; expected && d < N; d++) { // the checksums name the member that changed
+            if (crcs[i * N + d] == expected[i * N + d]) continue;
+            badBlocks++;
+            pthread_mutex_lock(&s->lock);
+            fprintf(s->report, "stripe %" PRId64 ": disk %d (%s) checksum mismatch\n", stripe, d, s->disks[d].path);
+            pthread_mutex_unlock(&s->lock);
+        }
+    }
+    pthread_mutex_lock(&s->lock);
+    s->stats.stripes += count;
+    s->stats.badStripes += badStripes;
+    s->stats.badBlocks += badBlocks;
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void *scrubWorker(void *arg) {
+    scrub_t *s = arg;
+    const raid5_geom_t *g = s->g;
+    int N = g->N;
+    int64_t B = g->B, span = s->window * B;
+    unsigned char *buf = io_alloc((size_t)(N * span));
+    unsigned char *scratch = malloc((size_t)(2 * B)); // recomputed P and Q
+    uint32_t *crcs = malloc(s->window * N * sizeof(uint32_t));
+    uint32_t *expected = malloc(s->window * N * sizeof(uint32_t));
+    io_t *io = io_open(N);
+    if (!buf || !scratch || !crcs || !expected || !io) {
+        perror("Failed to allocate scrub buffers");
+        setFailed(s);
+    }
+
+    int64_t first;
+    while (buf && scratch && crcs && expected && io && (first = claimWindow(s)) >= 0) {
+        int64_t count = g->K / B - first < s->window ? g->K / B - first : s->window;
+        int64_t crcOff = (int64_t)sizeof(sidecar_header_t) + first * N * (int64_t)sizeof(uint32_t);
+        size_t crcLen = count * N * sizeof(uint32_t);
+        int ok = 1;
+        for (int d = 0; d < N && ok; d++) { // every member is read at once
+            ok = disk_queue_read(io, &s->disks[d], buf + d * span, count * B, first * B) == 0;
+        }
+        if (io_wait(io) != 0 || !ok) {
+            perror("Failed to read the array");
+            ok = 0;
+        }
+        for (int d = 0; d < N && ok && s->sidecar >= 0; d++) {
+            for (int64_t i = 0; i < count; i++) {
+                crcs[i * N + d] = crc32c(0, buf + d * span + i * B, B);
+            }
+        }
+        if (ok && s->writeChecksums) {
+            if (full_pwrite(s->sidecar, crcs, crcLen, crcOff) != 0) {
+                perror(s->sidecarPath);
+                ok = 0;
+            }
+        } else if (ok) {
+            if (s->sidecar >= 0 && full_pread(s->sidecar, expected, crcLen, crcOff) != 0) {
+                perror(s->sidecarPath);
+                ok = 0;
+            } else {
+                checkWindow(s, buf, span, crcs, s->sidecar >= 0 ? expected : NULL, first, count, scratch, scratch + B);
+            }
+        }
+        if (!ok) setFailed(s);
+    }
+    io_close(io);
+    free(buf);
+    free(scratch);
+    free(crcs);
+    free(expected);
+    return NULL;
+}
+
+static int runScrub(scrub_t *s, int threads) {
+    s->window = SCRUB_WINDOW / s->g->B; // whole stripes so every block of a stripe is in memory at once
+    if (s->window < 1) s->window = 1;
+    pthread_mutex_init(&s->lock, NULL);
+
+    int64_t numWindows = (s->g->K / s->g->B + s->window - 1) / s->window;
+    if (threads > numWindows) threads = (int)numWindows;
+    if (threads <= 1) {
+        scrubWorker(s);
+    } else {
+        pthread_t *workers = malloc(threads * sizeof(pthread_t));
+        if (!workers) {
+            perror("Failed to allocate scrub threads");
+            pthread_mutex_destroy(&s->lock);
+            return -1;
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_create(&workers[i], NULL, scrubWorker, s);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
+    }
+    pthread_mutex_destroy(&s->lock);
+    return s->failed ? -1 : 0;
+}
+
+int raid5_checksum(const raid5_geom_t *g, disk_t *disks, const char *path, int threads) {
+    scrub_t s = {0};
+    s.g = g;
+    s.disks = disks;
+    s.writeChecksums = 1;
+    s.sidecarPath = path;
+    s.sidecar = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (s.sidecar < 0) {
+        perror(path);
+        return -1;
+    }
+    sidecar_header_t header = {SIDECAR_MAGIC, g->B, g->K, g->N};
+    int status = full_pwrite(s.sidecar, &header, sizeof(header), 0);
+    if (status != 0) perror(path);
+    if (status == 0) status = runScrub(&s, threads);
+    if (close(s.sidecar) != 0 && status == 0) {
+        perror(path);
+        status = -1;
+    }
+    return status;
+}
+
+int raid5_scrub(const raid5_geom_t *g, disk_t *disks, int raid6, const char *checksumPath, int threads,
+                FILE *report, raid5_scrub_stats_t *stats) {
+    scrub_t s = {0};
+    s.g = g;
+    s.disks = disks;
+    s.raid6 = raid6;
+    s.report = report;
+    s.sidecar = -1;
+    s.sidecarPath = checksumPath;
+    if (checksumPath) {
+        sidecar_header_t header;
+        s.sidecar = open(checksumPath, O_RDONLY);
+        if (s.sidecar < 0 || full_pread(s.sidecar, &header, sizeof(header), 0) != 0) {
+            perror(checksumPath);
+            if (s.sidecar >= 0) close(s.sidecar);
+            return -1;
+        }
+        if (memcmp(header.magic, SIDECAR_MAGIC, sizeof(header.magic)) != 0
+         || header.B != g->B || header.K != g->K || header.N != g->N) {
+            fprintf(stderr, "%s: checksums were written for a different array\n", checksumPath);
+            close(s.sidecar);
+            return -1;
+        }
+    }
+    int status = runScrub(&s, threads);
+    if (s.sidecar >= 0) close(s.sidecar);
+    *stats = s.stats;
+    return status;
+}
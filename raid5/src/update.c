@@ -0,0 +1,115 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raid5.h"
+#include "xor.h"
+
+#define UPDATE_WINDOW (1 << 20) // bytes per disk written in one full-stripe batch
+
+// read-modify-write the part of one stripe that [off, off + len) covers
+static int updatePartial(const raid5_geom_t *g, disk_t *disks, const unsigned char *buf,
+                         int64_t len, int64_t off, int64_t stripe, unsigned char *old, unsigned char *parity) {
+    int perStripe = g->N - 1;
+    int64_t B = g->B, stripeStart = stripe * perStripe * B;
+    int64_t from = off > stripeStart ? off : stripeStart; // logical bytes of this stripe to change
+    int64_t to = off + len < stripeStart + perStripe * B ? off + len : stripeStart + perStripe * B;
+
+    // parity only changes at the in-block offsets some touched block covers
+    int64_t lo = (to - from >= B) ? 0 : (from - stripeStart) % B;
+    int64_t hi = (to - from >= B) ? B : (to - 1 - stripeStart) % B + 1;
+    if (hi <= lo) { // the range wraps past a block boundary without covering a whole block
+        lo = 0;
+        hi = B;
+    }
+    int parityDisk = raid5_parity_disk(g, stripe);
+    if (disk_read(&disks[parityDisk], parity, hi - lo, stripe * B + lo) != 0) {
+        perror(disks[parityDisk].path);
+        return -1;
+    }
+
+    for (int64_t pos = from; pos < to; ) {
+        int i = (int)((pos - stripeStart) / B); // data block within the stripe
+        int64_t start = (pos - stripeStart) % B; // bytes of this block to change
+        int64_t end = to - stripeStart - i * B < B ? to - stripeStart - i * B : B;
+        int disk = raid5_data_disk(g, stripe, i);
+        int64_t diskOff = stripe * B + start;
+
+        if (disk_read(&disks[disk], old, end - start, diskOff) != 0) {
+            perror(disks[disk].path);
+            return -1;
+        }
+        xor_into(old, buf + pos - off, end - start); // old ^ new
+        xor_into(parity + start - lo, old, end - start); // P ^= old ^ new
+        if (disk_write(&disks[disk], buf + pos - off, end - start, diskOff) != 0) {
+            perror(disks[disk].path);
+            return -1;
+        }
+        pos += end - start;
+    }
+
+    if (disk_write(&disks[parityDisk], parity, hi - lo, stripe * B + lo) != 0) {
+        perror(disks[parityDisk].path);
+        return -1;
+    }
+    return 0;
+}
+
+// write count whole stripes starting at stripe, computing parity from the new data alone
+static int updateFull(const raid5_geom_t *g, disk_t *disks, const unsigned char *data,
+                      int64_t stripe, int64_t count, int64_t window, unsigned char *bufs) {
+    int N = g->N, perStripe = N - 1;
+    int64_t B = g->B;
+    memset(bufs, 0, (size_t)(N * window * B));
+    for (int64_t s = 0; s < count; s++) {
+        unsigned char *parity = bufs + (raid5_parity_disk(g, stripe + s) * window + s) * B;
+        for (int i = 0; i < perStripe; i++) {
+            unsigned char *block = bufs + (raid5_data_disk(g, stripe + s, i) * window + s) * B;
+            memcpy(block, data + (s * perStripe + i) * B, B);
+            xor_into(parity, block, B);
+        }
+    }
+    for (int d = 0; d < N; d++) { // one sequential write per disk
+        if (disk_write(&disks[d], bufs + d * window * B, count * B, stripe * B) != 0) {
+            perror(disks[d].path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int raid5_update(const raid5_geom_t *g, disk_t *disks, const unsigned char *buf, int64_t len, int64_t off) {
+    if (len == 0) return 0;
+    if (off < 0 || len < 0 || off + len > raid5_capacity(g)) {
+        errno = EINVAL;
+        return -1;
+    }
+    int N = g->N;
+    int64_t B = g->B, stripeBytes = (N - 1) * B;
+    int64_t window = UPDATE_WINDOW / B; // stripes per full-stripe batch
+    if (window < 1) window = 1;
+    if (window > len / stripeBytes) window = len / stripeBytes > 0 ? len / stripeBytes : 1;
+
+    unsigned char *old = malloc((size_t)B), *parity = malloc((size_t)B);
+    unsigned char *bufs = malloc((size_t)(N * window * B));
+    int status = old && parity && bufs ? 0 : -1;
+
+    for (int64_t pos = off; status == 0 && pos < off + len; ) {
+        int64_t stripe = pos / stripeBytes;
+        int64_t stripeStart = stripe * stripeBytes;
+        if (pos == stripeStart && off + len - pos >= stripeBytes) { // whole stripes: no reads needed
+            int64_t count = (off + len - pos) / stripeBytes;
+            if (count > window) count = window;
+            status = updateFull(g, disks, buf + pos - off, stripe, count, window, bufs);
+            pos += count * stripeBytes;
+        } else {
+            status = updatePartial(g, disks, buf, len, off, stripe, old, parity);
+            pos = stripeStart + stripeBytes;
+        }
+    }
+    free(old);
+    free(parity);
+    free(bufs);
+    return status;
+}
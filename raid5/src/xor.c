@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "xor.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// 128 bytes per iteration in four 256-bit lanes
+__attribute__((target("avx2")))
+static size_t xorAvx2(unsigned char *dst, const unsigned char *src, size_t len) {
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        for (int k = 0; k < 4; k++) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i + 32 * k));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(src + i + 32 * k));
+            _mm256_storeu_si256((__m256i *)(dst + i + 32 * k), _mm256_xor_si256(a, b));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t xorSse2(unsigned char *dst, const unsigned char *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+    }
+    return i;
+}
+#endif
+
+void xor_into(unsigned char *dst, const unsigned char *src, size_t len) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        i = xorAvx2(dst, src, len);
+    } else if (__builtin_cpu_supports("sse2")) {
+        i = xorSse2(dst, src, len);
+    }
+#endif
+    for (; i + 8 <= len; i += 8) { // portable word-at-a-time tail
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
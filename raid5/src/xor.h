@@ -0,0 +1,9 @@
+#ifndef __XOR_HEADER__
+#define __XOR_HEADER__
+
+#include <stddef.h>
+
+// dst ^= src over len bytes, using the widest vector unit the CPU offers
+void xor_into(unsigned char *dst, const unsigned char *src, size_t len);
+
+#endif
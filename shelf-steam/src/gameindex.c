@@ -0,0 +1,299 @@
+#define _GNU_SOURCE // enable GNU extensions
+#include <dirent.h> // include directory entry library
+#include <errno.h> // include error number library
+#include <fcntl.h> // include file control library
+#include <stdint.h> // include fixed width integer library
+#include <stdio.h> // include standard input/output library
+#include <stdlib.h> // include standard library
+#include <string.h> // include string library
+#include <unistd.h> // include unix standard library
+#include <sys/inotify.h> // include inotify library
+
+#include "gameindex.h"
+
+#define WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_CLOSE_WRITE | IN_MODIFY | \
+                      IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) // anything that can change what ls shows
+#define EVENT_BUFFER 65536 // bytes of inotify events read at once
+#define DENTS_BUFFER (1 << 20) // bytes of directory entries read per getdents64 call
+#define NAME_BLOCK (1 << 18) // bytes per name arena block
+#define DEAD_LIMIT (1 << 20) // arena bytes of removed names tolerated before a rescan compacts them
+
+static int cmpGames(const void *a, const void *b) { // sort games by name
+    return strcmp(((const GameEntry *)a)->name, ((const GameEntry *)b)->name);
+}
+
+// sort record: the first 8 bytes of a name as a big-endian number settle almost every comparison
+typedef struct {
+    uint64_t prefix; // leading name bytes, zero padded
+    const char *name; // whole name, for ties
+    int slot; // position in the unsorted scan
+} SortKey;
+
+static int cmpKeys(const void *a, const void *b) { // same order as strcmp on the names
+    return strcmp(((const SortKey *)a)->name, ((const SortKey *)b)->name);
+}
+
+// sort the scanned games by name: radix sort on the name prefixes, then strcmp only where prefixes tie
+static void sortGames(GameIndex *index) {
+    int count = index->count;
+    if (count < 2) return; // nothing to order
+    SortKey *keys = malloc(2 * count * sizeof(SortKey) + 1); // keys and the radix scratch space
+    GameEntry *sorted = malloc(index->capacity * sizeof(GameEntry) + 1); // games in name order
+    if (!keys || !sorted) { // fall back to sorting in place
+        free(keys);
+        free(sorted);
+        qsort(index->games, count, sizeof(GameEntry), cmpGames);
+        return;
+    }
+    SortKey *scratch = keys + count;
+    for (int i = 0; i < count; i++) {
+        const unsigned char *name = (const unsigned char *)index->games[i].name;
+        uint64_t prefix = 0;
+        int j = 0;
+        for (; j < 8 && name[j]; j++) prefix = prefix << 8 | name[j]; // pack the leading bytes
+        keys[i].prefix = j < 8 ? prefix << 8 * (8 - j) : prefix; // short names sort before their extensions
+        keys[i].name = index->games[i].name;
+        keys[i].slot = i;
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) { // least significant byte first, each pass stable
+        int buckets[257] = {0}; // start of every byte value in the output
+        for (int i = 0; i < count; i++) buckets[(keys[i].prefix >> shift & 0xff) + 1]++;
+        if (buckets[(keys[0].prefix >> shift & 0xff) + 1] == count) continue; // every name has the same byte here
+        for (int b = 0; b < 256; b++) buckets[b + 1] += buckets[b];
+        for (int i = 0; i < count; i++) scratch[buckets[keys[i].prefix >> shift & 0xff]++] = keys[i];
+        SortKey *temp = keys; // the output becomes the next pass's input
+        keys = scratch;
+        scratch = temp;
+    }
+
+    for (int i = 0; i < count; ) { // names sharing their first 8 bytes are ordered by the rest
+        int end = i + 1;
+        while (end < count && keys[end].prefix == keys[i].prefix) end++;
+        if (end - i > 1) qsort(keys + i, end - i, sizeof(SortKey), cmpKeys);
+        i = end;
+    }
+
+    for (int i = 0; i < count; i++) { // move the entries into name order
+        sorted[i] = index->games[keys[i].slot];
+    }
+    free(keys < scratch ? keys : scratch); // the allocation starts at the lower of the two halves
+    free(index->games);
+    index->games = sorted;
+}
+
+// position of name in the index, or where it would be inserted when found is 0
+static int searchGames(const GameIndex *index, const char *name, int *found) {
+    int lo = 0, hi = index->count - 1;
+    while (lo <= hi) { // binary search by name
+        int mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(index->games[mid].name, name);
+        if (cmp == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    *found = 0;
+    return lo;
+}
+
+static void fillEntry(GameEntry *game, const struct stat *pathStat) {
+    game->hasStat = 1;
+    game->mode = pathStat->st_mode;
+    game->inode = pathStat->st_ino;
+    game->size = pathStat->st_size;
+    game->mtime = pathStat->st_mtim;
+}
+
+// copy a name into the arena, NULL when out of memory
+static const char *storeName(GameIndex *index, const char *name) {
+    size_t len = strlen(name) + 1;
+    NameBlock *block = index->names;
+    if (!block || block->size - block->used < len) { // start a new block, big enough for long names
+        size_t size = len > NAME_BLOCK ? len : NAME_BLOCK;
+        block = malloc(sizeof(NameBlock) + size);
+        if (!block) return NULL;
+        block->next = index->names;
+        block->used = 0;
+        block->size = size;
+        index->names = block;
+    }
+    char *copy = block->data + block->used;
+    memcpy(copy, name, len);
+    block->used += len;
+    return copy;
+}
+
+static void clearGames(GameIndex *index) {
+    while (index->names) { // names are freed a block at a time
+        NameBlock *next = index->names->next;
+        free(index->names);
+        index->names = next;
+    }
+    index->count = 0;
+    index->deadBytes = 0;
+}
+
+static int growGames(GameIndex *index) {
+    if (index->count < index->capacity) return 0;
+    int capacity = index->capacity ? index->capacity * 2 : 64; // double capacity
+    GameEntry *temp = realloc(index->games, capacity * sizeof(GameEntry));
+    if (!temp) return -1;
+    index->games = temp;
+    index->capacity = capacity;
+    return 0;
+}
+
+// add one directory entry during a scan, trusting d_type to skip directories without a stat
+static void scanEntry(GameIndex *index, const char *name, unsigned char type) {
+    if (name[0] == '.') return; // hidden files are not games
+    if (type == DT_DIR) return; // check if entry is a directory
+    struct stat pathStat; // struct to hold path status
+    int needStat = type == DT_UNKNOWN || type == DT_LNK; // file system without d_type, or a link that may point at a directory
+    if (needStat && (fstatat(index->dirFd, name, &pathStat, 0) != 0 || S_ISDIR(pathStat.st_mode))) return;
+    if (growGames(index) != 0) return; // keep what fits
+
+    GameEntry *game = &index->games[index->count];
+    game->name = storeName(index, name);
+    if (!game->name) return;
+    game->hasStat = 0; // filled in when ls or a launch needs it
+    if (needStat) fillEntry(game, &pathStat);
+    index->count++;
+}
+
+// read the whole directory again, used at startup and whenever events were lost
+static int rescanGames(GameIndex *index) {
+    int dirFd = open(index->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC); // the repo may have been replaced, reopen it
+    if (dirFd < 0) return -1;
+    char *buffer = malloc(DENTS_BUFFER); // batch of raw directory entries
+    if (!buffer) {
+        close(dirFd);
+        return -1;
+    }
+    if (index->dirFd >= 0) close(index->dirFd);
+    index->dirFd = dirFd;
+    clearGames(index);
+
+    ssize_t len;
+    while ((len = getdents64(dirFd, buffer, DENTS_BUFFER)) > 0) { // thousands of entries per call
+        for (ssize_t pos = 0; pos < len; ) {
+            struct dirent64 *entry = (struct dirent64 *)(buffer + pos);
+            scanEntry(index, entry->d_name, entry->d_type);
+            pos += entry->d_reclen;
+        }
+    }
+    free(buffer);
+
+    sortGames(index);
+    index->stale = 0;
+    return len < 0 ? -1 : 0;
+}
+
+// re-stat one name after an event and insert, update or drop its entry
+static void refreshGame(GameIndex *index, const char *name) {
+    if (name[0] == '.') return; // hidden files are not games
+    struct stat pathStat; // struct to hold path status
+    int isGame = fstatat(index->dirFd, name, &pathStat, 0) == 0 && !S_ISDIR(pathStat.st_mode); // gone, or turned into a directory
+
+    int found;
+    int pos = searchGames(index, name, &found);
+    if (found && isGame) { // rebuilt or chmod'ed
+        fillEntry(&index->games[pos], &pathStat);
+    } else if (found) { // deleted or moved away
+        index->deadBytes += strlen(name) + 1; // reclaimed by the next rescan
+        memmove(&index->games[pos], &index->games[pos + 1], (index->count - pos - 1) * sizeof(GameEntry));
+        index->count--;
+        if (index->deadBytes > DEAD_LIMIT) index->stale = 1; // compact the arena
+    } else if (isGame) { // new game
+        const char *nameCopy = growGames(index) == 0 ? storeName(index, name) : NULL; // copy game name
+        if (!nameCopy) {
+            index->stale = 1; // rescan later
+            return;
+        }
+        memmove(&index->games[pos + 1], &index->games[pos], (index->count - pos) * sizeof(GameEntry));
+        index->games[pos].name = nameCopy;
+        fillEntry(&index->games[pos], &pathStat);
+        index->count++;
+    }
+}
+
+int openGameIndex(GameIndex *index, const char *path) {
+    memset(index, 0, sizeof(*index));
+    index->dirFd = -1;
+    index->path = strdup(path); // store repo path
+    index->watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC); // events are drained on every sync
+    index->watchWd = index->watchFd >= 0 ? inotify_add_watch(index->watchFd, path, WATCH_EVENTS) : -1; // watch before scanning so nothing is missed
+    if (!index->path || rescanGames(index) != 0) {
+        closeGameIndex(index);
+        return -1;
+    }
+    return 0;
+}
+
+void closeGameIndex(GameIndex *index) {
+    clearGames(index);
+    free(index->games);
+    free(index->path);
+    if (index->dirFd >= 0) close(index->dirFd);
+    if (index->watchFd >= 0) close(index->watchFd); // drops the watch as well
+    memset(index, 0, sizeof(*index));
+    index->dirFd = -1;
+    index->watchFd = -1;
+    index->watchWd = -1;
+}
+
+int syncGameIndex(GameIndex *index) {
+    if (index->watchFd < 0) return rescanGames(index); // nothing to tell us what changed
+
+    char buffer[EVENT_BUFFER] __attribute__((aligned(__alignof__(struct inotify_event)))); // events read at once
+    ssize_t len;
+    while ((len = read(index->watchFd, buffer, sizeof(buffer))) > 0) { // nothing pending costs one read
+        for (char *ptr = buffer; ptr < buffer + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                index->stale = 1; // lost events
+            } else if (event->wd != index->watchWd) {
+                continue; // left over from a directory no longer watched
+            } else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) { // the repo itself went away
+                if (event->mask & IN_MOVE_SELF) inotify_rm_watch(index->watchFd, event->wd); // follow the path, not the inode
+                index->watchWd = -1;
+                index->stale = 1;
+            } else if (event->len > 0 && !index->stale) {
+                refreshGame(index, event->name);
+            }
+        }
+    }
+    if (len < 0 && errno != EAGAIN && errno != EINTR) index->stale = 1; // broken watch, rescan
+    if (index->watchWd < 0) { // re-arm before rescanning so nothing is missed
+        index->watchWd = inotify_add_watch(index->watchFd, index->path, WATCH_EVENTS);
+    }
+    if (index->stale || index->watchWd < 0) return rescanGames(index); // returns -1 if the repo is gone
+    return 0;
+}
+
+GameEntry *findGame(const GameIndex *index, const char *name) {
+    int found;
+    int pos = searchGames(index, name, &found);
+    return found ? &index->games[pos] : NULL;
+}
+
+int statGame(GameIndex *index, GameEntry *game) {
+    if (game->hasStat) return 0; // kept current by refreshGame
+    struct stat pathStat; // struct to hold path status
+    if (fstatat(index->dirFd, game->name, &pathStat, 0) != 0) return -1; // removed, its event is still queued
+    fillEntry(game, &pathStat);
+    return 0;
+}
+
+char *gamePathOf(const GameIndex *index, const char *name) {
+    size_t pathLen = strlen(index->path), nameLen = strlen(name);
+    char *gamePath = malloc(pathLen + nameLen + 2); // no fixed limit on path length
+    if (!gamePath) return NULL;
+    memcpy(gamePath, index->path, pathLen);
+    gamePath[pathLen] = '/';
+    memcpy(gamePath + pathLen + 1, name, nameLen + 1);
+    return gamePath;
+}
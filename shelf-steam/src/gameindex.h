@@ -0,0 +1,59 @@
+#ifndef GAMEINDEX_H
+#define GAMEINDEX_H
+
+#include <stddef.h> // include standard definitions library
+#include <sys/stat.h> // include system stat library
+#include <sys/types.h> // include system types library
+#include <time.h> // include time library
+
+// one launchable entry of the repo directory
+typedef struct {
+    const char *name; // file name inside the repo, stored in the index's name arena
+    int hasStat; // whether the fields below are filled in, see statGame
+    mode_t mode; // file type and permissions
+    ino_t inode; // inode number
+    off_t size; // size in bytes
+    struct timespec mtime; // last modification time
+} GameEntry;
+
+// block of the arena game names are packed into; blocks never move, so names stay valid
+typedef struct NameBlock {
+    struct NameBlock *next; // previously filled block
+    size_t used; // bytes handed out
+    size_t size; // bytes in data
+    char data[]; // names, NUL terminated
+} NameBlock;
+
+// live, sorted view of the games in one repo directory
+typedef struct {
+    char *path; // repo directory
+    int dirFd; // open repo directory, every lookup is relative to it
+    int watchFd; // inotify descriptor, -1 when changes cannot be watched
+    int watchWd; // watch on the directory, -1 while it has none
+    int stale; // whether the next sync must rescan the whole directory
+    GameEntry *games; // games sorted by name
+    int count; // number of games
+    int capacity; // allocated entries
+    NameBlock *names; // arena holding every name, newest block first
+    size_t deadBytes; // arena bytes of games removed since the last rescan
+} GameIndex;
+
+// scan path and start watching it; returns -1 if the directory cannot be read
+int openGameIndex(GameIndex *index, const char *path);
+
+// stop watching and free every entry
+void closeGameIndex(GameIndex *index);
+
+// apply the changes made to the directory since the last sync; returns -1 if it cannot be read
+int syncGameIndex(GameIndex *index);
+
+// look up a game by name, NULL if there is none
+GameEntry *findGame(const GameIndex *index, const char *name);
+
+// fill in the status of a game the scan took from d_type alone; returns -1 if it is gone
+int statGame(GameIndex *index, GameEntry *game);
+
+// repo path joined with a game name, to be freed by the caller; NULL when out of memory
+char *gamePathOf(const GameIndex *index, const char *name);
+
+#endif
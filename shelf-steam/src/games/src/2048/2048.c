@@ -7,10 +7,15 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "engine.h"
+#include "solver.h"
+
 #define SIDE 4
 
 int seed = 42;
-int arr[SIDE][SIDE] = {0}, prev[SIDE][SIDE], c[SIDE];
+int hint = 0, autoplay = 0;
+Board board = 0;
+Rng rng;
 
 // Show the help description
 void showHelp(char *str) {
@@ -23,6 +28,8 @@ void showUsage(char *str) {
 	printf("Options:\n");
 	printf("\t--help : print game description\n");
 	printf("\t--seed INT : change the seed for pseudo-random number generation\n");
+	printf("\t--hint : suggest a move before every prompt\n");
+	printf("\t--auto : let the solver play\n");
 }
 
 // Show the instructions
@@ -40,8 +47,8 @@ void showBoard() {
 			printf("-");
 		printf("\n|");
         for(int j=0; j < SIDE; j++) {
-            if(arr[i][j] != 0)
-				printf(" %4d |", arr[i][j]);
+            if(tileAt(board, i, j) != 0)
+				printf(" %4d |", tileAt(board, i, j));
 			else
 				printf("      |");
         }
@@ -52,76 +59,23 @@ void showBoard() {
 	printf("\n\n");
 }
 
-// Add a random number to the game board
-void addNumber() {
-    int i, j; // RANDOM INDEX
-    do {
-        i = rand()%SIDE;
-        j = rand()%SIDE;
-    } while(arr[i][j] != 0);
-
-    int no = rand()%30;
-    if(no == 0)
-        arr[i][j] = 4;
-    else if(no < 6)
-        arr[i][j] = 2;
-    else
-		arr[i][j] = 1;
-}
-
-// Update the array after move
-void update() {
-    for(int i = SIDE-1; i > 0; i--) {
-        if(c[i] == c[i-1]) {
-            c[i] += c[i-1];
-            c[i-1] = 0;
-        }
-        else if(c[i-1] == 0 && c[i] != 0) {
-            c[i-1] = c[i];
-            c[i] = 0;
-        }
-    }
-
-	for(int i=SIDE-1, j=SIDE-1; i >= 0; i--) {
-		if(c[i] != 0 && c[j] == 0) {
-			c[j] = c[i];
-			c[i] = 0;
-		}
-		if(c[j] != 0)
-			j--;
-	}
-}
-
-// Check winning condition
-int has2048() {
-	for(int i=0; i < SIDE; i++)
-		for(int j=0; j < SIDE; j++)
-			if(arr[i][j] == 2048)
-				return 1;
-	return 0;
-}
-
-// Check if there is any move available
-int hasMovesLeft() {
-	for(int i=0; i < SIDE; i++)
-		for(int j=0; j < SIDE; j++)
-			if(arr[i][j] == 0 || i > 0 && arr[i][j] == arr[i-1][j] || j > 0 && arr[i][j] == arr[i][j-1])
-				return 1;
-	return 0;				
-}
-
 // Function to check if the game is over
 int gameOver() {
-	return (has2048() || !hasMovesLeft());
+	return (has2048(board) || !hasMovesLeft(board));
 }
 
 // Play 2048
 void play2048() {
-	srand(seed);
+	if(hint || autoplay)
+		initSolver();
+	else
+		initEngine();
+	seedRng(&rng, seed);
 	showInstructions();
 
-	while(!gameOver()) {
-		addNumber();
+	int stuck = 0;
+	while(!stuck && !gameOver()) {
+		board = addTile(board, &rng);
 		if(gameOver())
 			break;
 
@@ -129,55 +83,45 @@ void play2048() {
 			showBoard();
 			printf("----------------------------------------\n\n");
 
-			for(int i=0; i < SIDE; i++)
-				for(int j=0; j < SIDE; j++)
-					prev[i][j] = arr[i][j];
-
+			Board prev = board;
 			int flag = 1;
-			printf("Enter your move (W,S,A,D): ");
-			char move = getchar();
-			while(getchar() != '\n') ;
-			printf("\n");
+			char move;
+			if(autoplay) {
+				int best = bestMove(board, MAX_SOLVER_THREADS);
+				if(best < 0) {
+					stuck = 1;
+					break;
+				}
+				move = moveLetter(best);
+				printf("Autoplay move: %c\n\n", move);
+			}
+			else {
+				if(hint) {
+					int best = bestMove(board, MAX_SOLVER_THREADS);
+					if(best >= 0)
+						printf("Hint: %c\n", moveLetter(best));
+				}
+				printf("Enter your move (W,S,A,D): ");
+				move = getchar();
+				while(getchar() != '\n') ;
+				printf("\n");
+			}
 			switch(move) {
 				case 'D':
 				case 'd':
-					for(int i=0; i < SIDE; i++) {
-						for(int j=0; j < SIDE; j++)
-							c[j] = arr[i][j];
-						update();
-						for(int j=0; j < SIDE; j++)
-							arr[i][j] = c[j];
-					}
+					board = moveBoard(board, MOVE_RIGHT);
 					break;
 				case 'A':
 				case 'a':
-					for(int i=0; i < SIDE; i++) {
-						for(int j=0; j < SIDE; j++)
-							c[SIDE-1-j] = arr[i][j];
-						update();
-						for(int j=0; j < SIDE; j++)
-							arr[i][j] = c[SIDE-1-j];
-					}
+					board = moveBoard(board, MOVE_LEFT);
 					break;
 				case 'S':
 				case 's':
-					for(int i=0; i < SIDE; i++) {
-						for(int j=0; j < SIDE; j++)
-							c[j] = arr[j][i];
-						update();
-						for(int j=0; j < SIDE; j++)
-							arr[j][i] = c[j];
-					}
+					board = moveBoard(board, MOVE_DOWN);
 					break;
 				case 'W':
 				case 'w':
-					for(int i=0; i < SIDE; i++) {
-						for(int j=0; j < SIDE; j++)
-							c[SIDE-1-j] = arr[j][i];
-						update();
-						for(int j=0; j < SIDE; j++)
-							arr[j][i] = c[SIDE-1-j];
-					}
+					board = moveBoard(board, MOVE_UP);
 					break;
 				default:
 					printf("Invalid input! Please enter W, S, A, or D.\n");
@@ -185,10 +129,7 @@ void play2048() {
 			}
 			if(!flag)
 				continue;
-			flag = 0;
-			for(int i=0; i < SIDE; i++)
-				for(int j=0; j < SIDE; j++)
-					flag |= prev[i][j] != arr[i][j];
+			flag = prev != board;
 			if(!flag)
 				printf("Invalid move, board did not change!\n");
 			else
@@ -199,7 +140,7 @@ void play2048() {
 	showBoard();
 	printf("----------------------------------------\n\n");
 
-	if(has2048())
+	if(has2048(board))
 		printf("You won\n");
 	else
 		printf("You lost!\n");
@@ -207,30 +148,31 @@ void play2048() {
 
 // Driver program
 int main(int argc, char **argv) {
-	if(argc == 1) {
-		play2048();
+	if(argc == 2 && strcmp(argv[1], "--help") == 0) {
+		showHelp(argv[0]);
+		return 0;
 	}
-	else if(argc == 2) {
-		if(strcmp(argv[1], "--help") == 0)
-			showHelp(argv[0]);
-		else
-			showUsage(argv[0]);
-	}
-	else if(argc == 3) {
-		if(strcmp(argv[1], "--seed") == 0) {
+	for(int i=1; i < argc; i++) {
+		if(strcmp(argv[i], "--hint") == 0)
+			hint = 1;
+		else if(strcmp(argv[i], "--auto") == 0)
+			autoplay = 1;
+		else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) {
 			int flag = 1;
-			for(char *p=argv[2]; *p != '\0'; p++)
+			for(char *p=argv[i+1]; *p != '\0'; p++)
 				flag &= isdigit(*p) != 0;
-			if(flag) {
-				seed = atoi(argv[2]);
-				play2048();
-			}
-			else
+			if(!flag) {
 				showUsage(argv[0]);
+				return 0;
+			}
+			seed = atoi(argv[++i]);
 		}
-		else
+		else {
 			showUsage(argv[0]);
+			return 0;
+		}
 	}
+	play2048();
 
 	return 0;
 }
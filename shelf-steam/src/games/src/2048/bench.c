@@ -0,0 +1,81 @@
+// Autoplay benchmark: the solver plays many seeds headless and reports speed and win rate
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "solver.h"
+
+double nowSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Play one game like play2048() with --auto, return the largest tile and count the moves
+int playGame(unsigned int seed, int threads, long *moves) {
+	Rng rng;
+	seedRng(&rng, seed);
+	Board board = 0;
+	while(!has2048(board) && hasMovesLeft(board)) {
+		board = addTile(board, &rng);
+		if(has2048(board) || !hasMovesLeft(board))
+			break;
+		int best = bestMove(board, threads);
+		if(best < 0)
+			break;
+		board = moveBoard(board, best);
+		(*moves)++;
+	}
+
+	int largest = 0;
+	for(int i=0; i < 4; i++)
+		for(int j=0; j < 4; j++)
+			if(tileAt(board, i, j) > largest)
+				largest = tileAt(board, i, j);
+	return largest;
+}
+
+int main(int argc, char **argv) {
+	int games = 20, threads = MAX_SOLVER_THREADS, verbose = 0;
+	unsigned int firstSeed = 1;
+	int opt;
+	while((opt = getopt(argc, argv, "n:s:j:v")) != -1) {
+		if(opt == 'n')
+			games = atoi(optarg);
+		else if(opt == 's')
+			firstSeed = strtoul(optarg, NULL, 10);
+		else if(opt == 'j')
+			threads = atoi(optarg);
+		else if(opt == 'v')
+			verbose = 1;
+		else
+			games = 0;
+	}
+	if(games <= 0 || threads <= 0 || optind != argc) {
+		fprintf(stderr, "Usage: %s [-n games] [-s first seed] [-j threads] [-v]\n", argv[0]);
+		return 1;
+	}
+
+	initSolver();
+	int wins = 0;
+	long moves = 0;
+	double start = nowSeconds();
+	for(int g=0; g < games; g++) {
+		long gameMoves = 0;
+		int largest = playGame(firstSeed + g, threads, &gameMoves);
+		wins += largest == 2048;
+		moves += gameMoves;
+		if(verbose)
+			printf("seed %u: %s with %d after %ld moves\n", firstSeed + g, largest == 2048 ? "won" : "lost", largest, gameMoves);
+	}
+	double seconds = nowSeconds() - start;
+
+	printf("games %d, threads %d\n", games, threads);
+	printf("won %d (%.1f%%)\n", wins, 100.0 * wins / games);
+	printf("moves %ld in %.2f s: %.0f moves/s, %.3f ms per move\n", moves, seconds, moves / seconds, 1e3 * seconds / moves);
+	return 0;
+}
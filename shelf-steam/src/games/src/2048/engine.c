@@ -0,0 +1,155 @@
+// Headless 2048 engine: bitboard moves through precomputed row tables
+
+#include "engine.h"
+
+#define ROW_MASK 0xFFFFULL
+
+static uint16_t rowRight[65536], rowLeft[65536]; // every 4 cell row after sliding it
+static uint8_t rowOpen[65536]; // whether the row has an empty cell or two equal neighbours
+
+// Apply the game's update() to one row, c[3] being the side tiles slide to
+static void updateRow(int c[4]) {
+	for(int i = 3; i > 0; i--) {
+		if(c[i] == c[i-1]) {
+			if(c[i] != 0 && c[i] < 15) // merging 2^(k-1) twice gives 2^k
+				c[i]++;
+			c[i-1] = 0;
+		}
+		else if(c[i-1] == 0 && c[i] != 0) {
+			c[i-1] = c[i];
+			c[i] = 0;
+		}
+	}
+
+	for(int i = 3, j = 3; i >= 0; i--) {
+		if(c[i] != 0 && c[j] == 0) {
+			c[j] = c[i];
+			c[i] = 0;
+		}
+		if(c[j] != 0)
+			j--;
+	}
+}
+
+static uint16_t reverseRow(uint16_t row) {
+	return (row >> 12) | ((row >> 4) & 0x00F0) | ((row << 4) & 0x0F00) | (row << 12);
+}
+
+void initEngine() {
+	for(int row = 0; row < 65536; row++) {
+		int c[4];
+		for(int j = 0; j < 4; j++)
+			c[j] = (row >> (4*j)) & 0xF;
+		rowOpen[row] = 0;
+		for(int j = 0; j < 4; j++)
+			if(c[j] == 0 || (j > 0 && c[j] == c[j-1]))
+				rowOpen[row] = 1;
+
+		updateRow(c);
+		uint16_t result = 0;
+		for(int j = 0; j < 4; j++)
+			result |= c[j] << (4*j);
+		rowRight[row] = result;
+	}
+	for(int row = 0; row < 65536; row++) // sliding left is sliding the mirrored row right
+		rowLeft[row] = reverseRow(rowRight[reverseRow(row)]);
+}
+
+void seedRng(Rng *rng, unsigned int seed) {
+	if(seed == 0)
+		seed = 1;
+	int32_t word = seed;
+	rng->state[0] = word;
+	for(int i = 1; i < 31; i++) { // state[i] = 16807 * state[i-1] % (2^31 - 1) without overflow
+		int32_t hi = word / 127773, lo = word % 127773;
+		word = 16807 * lo - 2836 * hi;
+		if(word < 0)
+			word += 2147483647;
+		rng->state[i] = word;
+	}
+	rng->front = 3;
+	rng->rear = 0;
+	for(int i = 0; i < 310; i++) // glibc throws away the first 10 rounds
+		nextRandom(rng);
+}
+
+int nextRandom(Rng *rng) {
+	uint32_t value = rng->state[rng->front] += rng->state[rng->rear];
+	if(++rng->front == 31)
+		rng->front = 0;
+	if(++rng->rear == 31)
+		rng->rear = 0;
+	return value >> 1;
+}
+
+Board addTile(Board board, Rng *rng) {
+	int i, j; // RANDOM INDEX
+	do {
+		i = nextRandom(rng)%4;
+		j = nextRandom(rng)%4;
+	} while((board >> (4*(4*i + j))) & 0xF);
+
+	int no = nextRandom(rng)%30;
+	Board tile = no == 0 ? 3 : no < 6 ? 2 : 1; // 4, 2 or 1
+	return board | tile << (4*(4*i + j));
+}
+
+Board transpose(Board x) {
+	Board a1 = x & 0xF0F00F0FF0F00F0FULL;
+	Board a2 = x & 0x0000F0F00000F0F0ULL;
+	Board a3 = x & 0x0F0F00000F0F0000ULL;
+	Board a = a1 | (a2 << 12) | (a3 >> 12);
+	Board b1 = a & 0xFF00FF0000FF00FFULL;
+	Board b2 = a & 0x00FF00FF00000000ULL;
+	Board b3 = a & 0x00000000FF00FF00ULL;
+	return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+// Slide every row through one of the tables
+static Board moveRows(Board board, const uint16_t *table) {
+	return (Board)table[board & ROW_MASK] |
+		(Board)table[(board >> 16) & ROW_MASK] << 16 |
+		(Board)table[(board >> 32) & ROW_MASK] << 32 |
+		(Board)table[board >> 48] << 48;
+}
+
+Board moveBoard(Board board, int move) {
+	switch(move) {
+		case MOVE_RIGHT:
+			return moveRows(board, rowRight);
+		case MOVE_LEFT:
+			return moveRows(board, rowLeft);
+		case MOVE_DOWN: // columns are rows of the transposed board
+			return transpose(moveRows(transpose(board), rowRight));
+		case MOVE_UP:
+			return transpose(moveRows(transpose(board), rowLeft));
+	}
+	return board;
+}
+
+int tileAt(Board board, int i, int j) {
+	int k = (board >> (4*(4*i + j))) & 0xF;
+	return k ? 1 << (k-1) : 0;
+}
+
+int emptyCells(Board board) {
+	board |= board >> 2; // fold every cell's bits into its lowest bit
+	board |= board >> 1;
+	board = ~board & 0x1111111111111111ULL;
+	return __builtin_popcountll(board);
+}
+
+int has2048(Board board) {
+	for(int k = 0; k < 64; k += 4)
+		if(((board >> k) & 0xF) == TILE_2048)
+			return 1;
+	return 0;
+}
+
+int hasMovesLeft(Board board) {
+	Board columns = transpose(board);
+	for(int k = 0; k < 64; k += 16)
+		if(rowOpen[(board >> k) & ROW_MASK] || rowOpen[(columns >> k) & ROW_MASK])
+			return 1;
+	return 0;
+}
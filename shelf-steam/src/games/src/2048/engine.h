@@ -0,0 +1,52 @@
+// Headless 2048 engine: bitboard moves through precomputed row tables
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdint.h>
+
+// 16 cells of 4 bits, cell (i, j) at bit 4*(4*i + j); 0 is empty and k > 0 is the tile 2^(k-1),
+// so the game's 1, 2, 4, ..., 2048 are 1, 2, 3, ..., 12 and tiles stop at 2^14
+typedef uint64_t Board;
+
+// glibc's TYPE_3 random number generator, one per game instead of the global rand() state
+typedef struct {
+	uint32_t state[31];
+	int front, rear;
+} Rng;
+
+enum { MOVE_UP, MOVE_DOWN, MOVE_LEFT, MOVE_RIGHT };
+
+#define TILE_2048 12
+
+// Build the row tables, needed once before any move
+void initEngine();
+
+// Seed like srand(seed), so the numbers match rand() for the same seed
+void seedRng(Rng *rng, unsigned int seed);
+
+// Next number, the same one rand() would return
+int nextRandom(Rng *rng);
+
+// Add a 1, 2 or 4 tile to a random empty cell, drawing numbers exactly like the original addNumber()
+Board addTile(Board board, Rng *rng);
+
+// Slide and merge the board in one direction
+Board moveBoard(Board board, int move);
+
+// Value of the tile at (i, j) as the game prints it, 0 when empty
+int tileAt(Board board, int i, int j);
+
+// Number of empty cells
+int emptyCells(Board board);
+
+// Check winning condition
+int has2048(Board board);
+
+// Check if there is an empty cell or two equal neighbours
+int hasMovesLeft(Board board);
+
+// Transpose the board: rows become columns
+Board transpose(Board board);
+
+#endif
@@ -0,0 +1,209 @@
+// Expectimax search over the 2048 engine, for hints and autoplay
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "solver.h"
+
+#define ROW_MASK 0xFFFFULL
+#define CACHE_BITS 18 // transposition table entries per root move, as a power of two
+#define CACHE_DEPTH 15 // chance nodes this deep or shallower are cached
+#define MIN_PROBABILITY 0.001f // boards less likely than this are evaluated instead of searched
+#define WIN_SCORE 1e9f // a board holding 2048 ends the game
+#define LOST_PENALTY 200000.0f // offset keeping every live board above a lost one
+
+// Heuristic weights, per row and per column
+#define MONOTONICITY_POWER 4.0
+#define MONOTONICITY_WEIGHT 47.0
+#define SUM_POWER 3.5
+#define SUM_WEIGHT 11.0
+#define MERGES_WEIGHT 700.0
+#define EMPTY_WEIGHT 270.0
+
+// one cached chance node
+typedef struct {
+	Board board;
+	float score;
+	uint32_t generation; // search that wrote it, older entries are empty
+	uint8_t depth; // depth it was searched at, only reused at the same depth or deeper
+} CacheEntry;
+
+// state of the search below one root move
+typedef struct {
+	Board board; // board after the root move
+	int depthLimit;
+	int depth;
+	CacheEntry *cache;
+	uint32_t generation;
+	float score;
+} Search;
+
+// probability of each tile addTile() draws: 1, 2 and 4
+static const float tileProbability[3] = {24.0f / 30, 5.0f / 30, 1.0f / 30};
+
+static float heuristicRow[65536]; // heuristic score of every row, lost penalty included
+static CacheEntry *caches[4]; // one transposition table per root move
+static uint32_t generation = 0; // searches so far
+
+// Score one row: empty cells, possible merges and monotone tiles are good, big tiles are costly
+static float scoreRow(int row) {
+	int rank[4];
+	for(int j = 0; j < 4; j++)
+		rank[j] = (row >> (4*j)) & 0xF;
+
+	double sum = 0;
+	int empty = 0, merges = 0, prev = 0, counter = 0;
+	for(int j = 0; j < 4; j++) {
+		sum += pow(rank[j], SUM_POWER);
+		if(rank[j] == 0) {
+			empty++;
+		}
+		else {
+			if(prev == rank[j])
+				counter++;
+			else if(counter > 0) {
+				merges += 1 + counter;
+				counter = 0;
+			}
+			prev = rank[j];
+		}
+	}
+	if(counter > 0)
+		merges += 1 + counter;
+
+	double monoLeft = 0, monoRight = 0;
+	for(int j = 1; j < 4; j++) {
+		if(rank[j-1] > rank[j])
+			monoLeft += pow(rank[j-1], MONOTONICITY_POWER) - pow(rank[j], MONOTONICITY_POWER);
+		else
+			monoRight += pow(rank[j], MONOTONICITY_POWER) - pow(rank[j-1], MONOTONICITY_POWER);
+	}
+
+	return LOST_PENALTY + EMPTY_WEIGHT * empty + MERGES_WEIGHT * merges -
+		MONOTONICITY_WEIGHT * (monoLeft < monoRight ? monoLeft : monoRight) - SUM_WEIGHT * sum;
+}
+
+void initSolver() {
+	initEngine();
+	for(int row = 0; row < 65536; row++)
+		heuristicRow[row] = scoreRow(row);
+	for(int i = 0; i < 4; i++) {
+		caches[i] = calloc(1 << CACHE_BITS, sizeof(CacheEntry));
+		if(caches[i] == NULL) {
+			perror("Failed to allocate the solver tables");
+			exit(1);
+		}
+	}
+}
+
+char moveLetter(int move) {
+	return "WSAD"[move];
+}
+
+// Sum of the row heuristic over rows and columns
+static float evaluate(Board board) {
+	Board columns = transpose(board);
+	float score = 0;
+	for(int k = 0; k < 64; k += 16)
+		score += heuristicRow[(board >> k) & ROW_MASK] + heuristicRow[(columns >> k) & ROW_MASK];
+	return score;
+}
+
+// Search deeper where few cells are empty: those boards have fewer chance outcomes and more risk
+static int depthFor(Board board) {
+	int empty = emptyCells(board);
+	return empty > 6 ? 1 : empty > 2 ? 2 : 3;
+}
+
+static float scoreMoveNode(Search *search, Board board, float probability);
+
+// Average over every empty cell and tile the game could add next
+static float scoreChanceNode(Search *search, Board board, float probability) {
+	if(has2048(board))
+		return WIN_SCORE;
+	if(probability < MIN_PROBABILITY || search->depth >= search->depthLimit)
+		return evaluate(board);
+
+	CacheEntry *entry = NULL;
+	if(search->depth < CACHE_DEPTH) {
+		uint64_t hash = board * 0x9E3779B97F4A7C15ULL; // Fibonacci hashing spreads nearby boards
+		entry = &search->cache[hash >> (64 - CACHE_BITS)];
+		if(entry->generation == search->generation && entry->board == board && entry->depth <= search->depth)
+			return entry->score;
+	}
+
+	int empty = emptyCells(board);
+	probability /= empty;
+	float sum = 0;
+	for(int k = 0; k < 64; k += 4) {
+		if((board >> k) & 0xF)
+			continue;
+		for(int tile = 0; tile < 3; tile++)
+			sum += scoreMoveNode(search, board | (Board)(tile + 1) << k, probability * tileProbability[tile]) *
+				tileProbability[tile];
+	}
+	float score = sum / empty;
+
+	if(entry) {
+		entry->board = board;
+		entry->score = score;
+		entry->generation = search->generation;
+		entry->depth = search->depth;
+	}
+	return score;
+}
+
+// Best of the four moves, 0 when none changes the board and the game is lost
+static float scoreMoveNode(Search *search, Board board, float probability) {
+	float best = 0;
+	search->depth++;
+	for(int move = 0; move < 4; move++) {
+		Board next = moveBoard(board, move);
+		if(next == board)
+			continue;
+		float score = scoreChanceNode(search, next, probability);
+		if(score > best)
+			best = score;
+	}
+	search->depth--;
+	return best;
+}
+
+static void *searchRoot(void *arg) {
+	Search *search = arg;
+	search->score = scoreChanceNode(search, search->board, 1.0f);
+	return NULL;
+}
+
+int bestMove(Board board, int threads) {
+	Search searches[4];
+	pthread_t workers[4];
+	int started[4] = {0};
+	int depthLimit = depthFor(board);
+	generation++;
+
+	for(int move = 0; move < 4; move++) {
+		Board next = moveBoard(board, move);
+		searches[move].score = -1;
+		if(next == board)
+			continue;
+		searches[move] = (Search){next, depthLimit, 0, caches[move], generation, 0};
+		if(threads > 1 && pthread_create(&workers[move], NULL, searchRoot, &searches[move]) == 0) {
+			started[move] = 1;
+			threads--;
+		}
+		else
+			searchRoot(&searches[move]);
+	}
+
+	int best = -1;
+	for(int move = 0; move < 4; move++) {
+		if(started[move])
+			pthread_join(workers[move], NULL);
+		if(searches[move].score >= 0 && (best < 0 || searches[move].score > searches[best].score))
+			best = move;
+	}
+	return best;
+}
@@ -0,0 +1,19 @@
+// Expectimax search over the 2048 engine, for hints and autoplay
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "engine.h"
+
+#define MAX_SOLVER_THREADS 4 // one per root move
+
+// Build the engine and heuristic tables and allocate the search caches, needed once before any search; exits if out of memory
+void initSolver();
+
+// Best move for the board, searching the root moves on up to threads threads; -1 when no move changes the board
+int bestMove(Board board, int threads);
+
+// Letter the game uses for a move: W, S, A or D
+char moveLetter(int move);
+
+#endif
@@ -18,6 +18,8 @@ int arr[9][9] = {{1,2,3,4,5,6,7,8,9},
 	{6,7,8,9,1,2,3,4,5},
 	{9,1,2,3,4,5,6,7,8}};
 int pos;
+int row_mask[9], col_mask[9], blk_mask[9]; // bit d is set while digit d is in the row, column or 3x3 box
+int empty; // cells left to fill
 
 // Show the help description
 void showHelp(char *str) {
@@ -116,29 +118,50 @@ void updatePosition(int di, int dj) {
 	pos = i*9+j;
 }
 
-// Check if there is any incosistency in the board
-int isValid() {
-	int count_row[9][10] = {0}, count_col[9][10] = {0}, count_blk[9][10] = {0};
+// Build the digit masks and count the empty cells of a new board
+void initMasks() {
+	empty = 0;
+	for(int i=0; i < 9; i++)
+		row_mask[i] = col_mask[i] = blk_mask[i] = 0;
 	for(int i=0; i < 9; i++)
 		for(int j=0; j < 9; j++) {
-			count_row[i][abs(arr[i][j])]++;
-			count_col[j][abs(arr[i][j])]++;
-			count_blk[(i/3)*3+j/3][abs(arr[i][j])]++;
+			if(arr[i][j] == 0)
+				empty++;
+			else {
+				row_mask[i] |= 1 << abs(arr[i][j]);
+				col_mask[j] |= 1 << abs(arr[i][j]);
+				blk_mask[(i/3)*3+j/3] |= 1 << abs(arr[i][j]);
+			}
 		}
-	for(int i=0; i < 9; i++)
-		for(int j=1; j <= 9; j++)
-			if(count_row[i][j] > 1 || count_col[i][j] > 1 || count_blk[i][j] > 1)
-				return 0;
-	return 1;
+}
+
+// Put a digit in a cell, keeping the masks and the empty count up to date
+void setCell(int i, int j, int digit) {
+	int b = (i/3)*3+j/3;
+	if(arr[i][j] == 0)
+		empty--;
+	else {
+		int old = 1 << abs(arr[i][j]);
+		row_mask[i] &= ~old;
+		col_mask[j] &= ~old;
+		blk_mask[b] &= ~old;
+	}
+	arr[i][j] = digit;
+	row_mask[i] |= 1 << digit;
+	col_mask[j] |= 1 << digit;
+	blk_mask[b] |= 1 << digit;
+}
+
+// Check if a digit can go in a cell without repeating one in its row, column or box
+int isValid(int i, int j, int digit) {
+	if(abs(arr[i][j]) == digit) // replacing a digit with itself
+		return 1;
+	return !((row_mask[i] | col_mask[j] | blk_mask[(i/3)*3+j/3]) & 1 << digit);
 }
 
 // Check winning condition
 int isOver() {
-	for(int i=0; i < 9; i++)
-		for(int j=0; j < 9; j++)
-			if(arr[i][j] == 0)
-				return 0;
-	return 1;
+	return empty == 0;
 }
 
 // Play Sudoku
@@ -147,13 +170,14 @@ void playSudoku() {
 	showInstructions();
 
 	createBoard();
+	initMasks();
 
 	while(!isOver()) {
 		for(;;) {
 			showBoard();
 			printf("----------------------------------------\n\n");
 
-			int flag = 1, old_value;
+			int flag = 1;
 			printf("Enter your move (W,S,A,D,[1-9]): ");
 			char move = getchar();
 			while(getchar() != '\n') ;
@@ -184,13 +208,12 @@ void playSudoku() {
 				case '7':
 				case '8':
 				case '9':
-					old_value = arr[pos/9][pos%9];
-					arr[pos/9][pos%9] = move-'0';
-					if(!isValid()) {
+					if(!isValid(pos/9, pos%9, move-'0')) {
 						flag = 0;
 						printf("This position cannot receive a %c!\n\n", move);
-						arr[pos/9][pos%9] = old_value;
 					}
+					else
+						setCell(pos/9, pos%9, move-'0');
 					break;
 				default:
 					printf("Invalid input! Please enter W, S, A, D, or a digit [1-9].\n\n");
@@ -0,0 +1,239 @@
+#define _GNU_SOURCE // enable GNU extensions
+#include <errno.h> // include error number library
+#include <fcntl.h> // include file control library
+#include <poll.h> // include poll library
+#include <signal.h> // include signal library
+#include <stdlib.h> // include standard library
+#include <string.h> // include string library
+#include <unistd.h> // include unix standard library
+#include <sys/signalfd.h> // include signalfd library
+#include <sys/wait.h> // include wait library
+#include <sys/resource.h> // include resource usage library
+#include <time.h> // include time library
+
+#include "jobs.h"
+#include "spawn.h"
+#include "zygote.h"
+
+#define POLL_FALLBACK_MS 10 // how often children are checked on when there is no signalfd
+
+// one command line: a single game or a pipeline of them
+typedef struct {
+    int id; // number shown as [id]
+    char *command; // command line as typed
+    int background; // started with &
+    int stages; // games in the pipeline
+    pid_t *pids; // pid of every stage, 0 once reaped or never started
+    int *statuses; // wait status of every stage
+    int running; // stages not reaped yet
+    char **games; // game name of every stage, as typed
+    long long startUs; // monotonic time the job was started
+    RunUsage usage; // resources of the stages reaped so far
+} Job;
+
+static Job *jobs = NULL; // jobs in start order
+static int jobCount = 0; // jobs in the table
+static int childFd = -1; // signalfd readable whenever a child changed state
+
+int initJobs(void) {
+    sigset_t mask; // SIGCHLD is only ever received through childFd
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) != 0) return -1;
+    childFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    return childFd < 0 ? -1 : 0;
+}
+
+static long long monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+static void freeJob(Job *job) {
+    for (int s = 0; job->games && s < job->stages; s++) free(job->games[s]);
+    free(job->games);
+    free(job->command);
+    free(job->pids);
+    free(job->statuses);
+}
+
+static Job *findJob(int id) {
+    for (int i = 0; i < jobCount; i++) {
+        if (jobs[i].id == id) return &jobs[i];
+    }
+    return NULL;
+}
+
+static void removeJob(Job *job) {
+    freeJob(job);
+    int pos = job - jobs;
+    memmove(&jobs[pos], &jobs[pos + 1], (jobCount - pos - 1) * sizeof(Job));
+    jobCount--;
+}
+
+void reapJobs(void) {
+    struct signalfd_siginfo info[16]; // pending notifications are only a wake-up, statuses come from waitpid
+    if (childFd >= 0) {
+        while (read(childFd, info, sizeof(info)) > 0) {} // drain
+    }
+    for (int i = 0; i < jobCount; i++) { // probes reap their own children, so only ask for ours
+        Job *job = &jobs[i];
+        for (int s = 0; s < job->stages && job->running > 0; s++) {
+            struct rusage usage; // resources of this stage alone
+            if (job->pids[s] > 0 && wait4(job->pids[s], &job->statuses[s], WNOHANG, &usage) == job->pids[s]) {
+                job->pids[s] = 0; // reaped, its status is kept until the job is reported
+                job->running--;
+                RunUsage stage = {0};
+                stage.wallUs = monotonicUs() - job->startUs;
+                addUsage(&stage, &usage);
+                recordRun(job->games[s], job->statuses[s], &stage, job->command);
+                addUsage(&job->usage, &usage);
+                if (job->running == 0) job->usage.wallUs = stage.wallUs; // the pipeline ends with its last stage
+            }
+        }
+    }
+}
+
+// sleep until some child changes state
+static void waitForChild(void) {
+    struct pollfd pfd = {childFd, POLLIN, 0};
+    if (childFd < 0 || poll(&pfd, 1, -1) < 0) { // interrupted, or no signalfd: check back shortly
+        poll(NULL, 0, POLL_FALLBACK_MS);
+    }
+}
+
+int startJob(char **paths, char ***argvs, int stages, const char *inputFile, const char *command, int background,
+             int outFd, int errFd, int *failed) {
+    Job job = {0};
+    job.command = strdup(command); // duplicate command line
+    job.background = background;
+    job.stages = stages;
+    job.pids = calloc(stages, sizeof(pid_t));
+    job.statuses = calloc(stages, sizeof(int));
+    job.games = calloc(stages, sizeof(char *));
+    int named = job.games != NULL; // whether every stage got its name
+    for (int i = 0; job.games && i < stages; i++) {
+        job.games[i] = strdup(argvs[i][0]); // stats are kept per game
+        if (!job.games[i]) named = 0;
+    }
+    Job *temp = realloc(jobs, (jobCount + 1) * sizeof(Job)); // room for the new job
+    if (temp) jobs = temp;
+    *failed = stages;
+    if (!job.command || !job.pids || !job.statuses || !named || !temp) {
+        freeJob(&job);
+        return -1;
+    }
+    job.startUs = monotonicUs(); // wall time includes the launch itself
+
+    pid_t pgid = 0; // background pipelines share the first stage's group
+    int prevRead = -1; // read end of the pipe from the previous stage
+    *failed = 0;
+    for (int i = 0; i < stages; i++) {
+        int pipefd[2] = {-1, -1}; // pipe to the next stage
+        if (i < stages - 1 && pipe2(pipefd, O_CLOEXEC) == -1) { // the rest of the pipeline cannot start
+            *failed += stages - i;
+            break;
+        }
+        SpawnIo io = SPAWN_IO_INHERIT;
+        io.inputFile = i == 0 ? inputFile : NULL; // < only applies to the first stage
+        if (i == 0 && !inputFile && (background || outFd >= 0)) io.inputFile = "/dev/null"; // neither background nor captured games may read the terminal
+        io.inFd = prevRead;
+        io.outFd = i < stages - 1 ? pipefd[1] : outFd;
+        io.errFd = errFd;
+        io.pgid = background ? pgid : -1;
+        pid_t pid = zygoteSpawn(paths[i], argvs[i], &io); // spawnGame when there is no pool
+        if (pid < 0) {
+            job.statuses[i] = 127 << 8; // exit status 127, like a shell's command not found
+            (*failed)++;
+        } else {
+            job.pids[i] = pid;
+            job.running++;
+            if (pgid == 0) pgid = pid;
+        }
+        if (prevRead >= 0) close(prevRead); // the child has its own copies now
+        if (pipefd[1] >= 0) close(pipefd[1]);
+        prevRead = pipefd[0];
+    }
+    if (prevRead >= 0) close(prevRead);
+
+    if (job.running == 0) { // nothing to track
+        freeJob(&job);
+        return -1;
+    }
+    job.id = jobCount > 0 ? jobs[jobCount - 1].id + 1 : 1; // like a shell, numbers restart once the table is empty
+    jobs[jobCount++] = job;
+    return job.id;
+}
+
+pid_t jobPid(int id) {
+    Job *job = findJob(id);
+    if (!job) return 0;
+    for (int s = job->stages - 1; s >= 0; s--) {
+        if (job->pids[s] > 0) return job->pids[s];
+    }
+    return 0;
+}
+
+const char *jobCommand(int id) {
+    Job *job = findJob(id);
+    return job ? job->command : NULL;
+}
+
+int lastJob(void) {
+    return jobCount > 0 ? jobs[jobCount - 1].id : 0;
+}
+
+int foregroundJob(int id, RunUsage *usage) {
+    if (waitJobs(id) != 0) return -1;
+    Job *job = findJob(id);
+    int status = job->statuses[job->stages - 1]; // a pipeline's status is its last stage's
+    if (usage) *usage = job->usage;
+    removeJob(job);
+    return status;
+}
+
+int waitJobs(int id) {
+    if (id != 0 && !findJob(id)) return -1;
+    while (1) {
+        reapJobs();
+        int busy = 0; // whether anything waited for is still running
+        for (int i = 0; i < jobCount; i++) {
+            if ((id == 0 || jobs[i].id == id) && jobs[i].running > 0) busy = 1;
+        }
+        if (!busy) return 0;
+        waitForChild();
+    }
+}
+
+static void describeStatus(int status, char *text, size_t size) {
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        snprintf(text, size, "Done");
+    } else if (WIFEXITED(status)) {
+        snprintf(text, size, "Exit %d", WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        snprintf(text, size, "Signal %d", WTERMSIG(status));
+    } else {
+        snprintf(text, size, "Done");
+    }
+}
+
+void reportJobs(FILE *out, int all) {
+    reapJobs();
+    for (int i = 0; i < jobCount; i++) {
+        Job *job = &jobs[i];
+        char state[32]; // Running, Done, Exit n or Signal n
+        if (job->running > 0) {
+            if (!all) continue;
+            snprintf(state, sizeof(state), "Running");
+        } else {
+            describeStatus(job->statuses[job->stages - 1], state, sizeof(state));
+        }
+        fprintf(out, "[%d] %-10s %s\n", job->id, state, job->command);
+        if (job->running == 0) { // reported once, then forgotten
+            removeJob(job);
+            i--;
+        }
+    }
+    fflush(out);
+}
@@ -0,0 +1,42 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdio.h> // include standard input/output library
+#include <sys/types.h> // include system types library
+
+#include "runstats.h"
+
+// block SIGCHLD and route it through a signalfd; returns -1 if children must be polled instead
+int initJobs(void);
+
+// start a pipeline of stages games, stage i running paths[i] with argvs[i];
+// inputFile feeds the first stage, background and captured (outFd >= 0) jobs without one read /dev/null;
+// the last stage writes to outFd and every stage to errFd when they are >= 0, the shell's streams otherwise;
+// returns the job id, or -1 if no stage started; *failed counts the stages that could not start
+int startJob(char **paths, char ***argvs, int stages, const char *inputFile, const char *command, int background,
+             int outFd, int errFd, int *failed);
+
+// pid of the last stage of a job, 0 if there is no such job
+pid_t jobPid(int id);
+
+// command line of a job, NULL if there is no such job
+const char *jobCommand(int id);
+
+// most recent job still in the table, 0 if there is none
+int lastJob(void);
+
+// wait for a job in the foreground and forget it, filling usage with its resources when it is not NULL;
+// returns the wait status of its last stage, -1 if there is no such job
+int foregroundJob(int id, RunUsage *usage);
+
+// wait for one job, or for every job when id is 0, leaving them to be reported; returns -1 if there is no such job
+int waitJobs(int id);
+
+// collect the exit status and resource usage of every finished game without blocking, recording each in the run stats;
+// wall time runs until the game is reaped, so background games are timed to the next prompt
+void reapJobs(void);
+
+// print finished jobs and forget them; with all set, list running jobs as well
+void reportJobs(FILE *out, int all);
+
+#endif
@@ -0,0 +1,116 @@
+#define _GNU_SOURCE // enable GNU extensions
+#include <stdlib.h> // include standard library
+#include <string.h> // include string library
+#include <time.h> // include time library
+#include <sys/wait.h> // include wait library
+
+#include "runstats.h"
+
+// totals of every run of one game this session
+typedef struct {
+    char *game; // game name as typed
+    int runs; // finished runs
+    int failures; // runs that exited non-zero or were killed
+    long long wallUs; // summed wall time
+    long long maxWallUs; // slowest run
+    long long cpuUs; // summed user and system time
+    long maxRssKb; // largest peak resident set
+} GameStats;
+
+static GameStats *stats = NULL; // one entry per game that finished
+static int statsCount = 0; // games in stats
+static FILE *runLog = NULL; // machine readable log, NULL when not asked for
+
+static long long timevalUs(struct timeval tv) {
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+void addUsage(RunUsage *total, const struct rusage *usage) {
+    total->userUs += timevalUs(usage->ru_utime);
+    total->sysUs += timevalUs(usage->ru_stime);
+    if (usage->ru_maxrss > total->maxRssKb) total->maxRssKb = usage->ru_maxrss; // stages run side by side, so peaks do not add up
+    total->voluntarySwitches += usage->ru_nvcsw;
+    total->involuntarySwitches += usage->ru_nivcsw;
+}
+
+int openRunLog(const char *path) {
+    runLog = fopen(path, "a"); // runs of earlier sessions are kept for comparison
+    if (!runLog) return -1;
+    if (ftell(runLog) == 0) { // new log, name the tab separated columns
+        fprintf(runLog, "# end_unix_ms\tgame\tstatus\twall_us\tuser_us\tsys_us\tmaxrss_kb\tvcsw\tivcsw\tcommand\n");
+        fflush(runLog);
+    }
+    return 0;
+}
+
+void closeRunStats(void) {
+    if (runLog) fclose(runLog);
+    runLog = NULL;
+    for (int i = 0; i < statsCount; i++) free(stats[i].game);
+    free(stats);
+    stats = NULL;
+    statsCount = 0;
+}
+
+static GameStats *findStats(const char *game) {
+    for (int i = 0; i < statsCount; i++) {
+        if (strcmp(stats[i].game, game) == 0) return &stats[i];
+    }
+    GameStats *temp = realloc(stats, (statsCount + 1) * sizeof(GameStats)); // first run of this game
+    char *name = strdup(game);
+    if (!temp || !name) {
+        if (temp) stats = temp;
+        free(name);
+        return NULL;
+    }
+    stats = temp;
+    GameStats *entry = &stats[statsCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->game = name;
+    return entry;
+}
+
+void recordRun(const char *game, int status, const RunUsage *usage, const char *command) {
+    int failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    GameStats *entry = findStats(game);
+    if (entry) {
+        entry->runs++;
+        entry->failures += failed;
+        entry->wallUs += usage->wallUs;
+        if (usage->wallUs > entry->maxWallUs) entry->maxWallUs = usage->wallUs;
+        entry->cpuUs += usage->userUs + usage->sysUs;
+        if (usage->maxRssKb > entry->maxRssKb) entry->maxRssKb = usage->maxRssKb;
+    }
+    if (!runLog) return;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : WIFSIGNALED(status) ? -WTERMSIG(status) : 0; // signals are negative
+    fprintf(runLog, "%lld\t%s\t%d\t%lld\t%lld\t%lld\t%ld\t%ld\t%ld\t%s\n",
+            now.tv_sec * 1000LL + now.tv_nsec / 1000000, game, code, usage->wallUs, usage->userUs, usage->sysUs,
+            usage->maxRssKb, usage->voluntarySwitches, usage->involuntarySwitches, command);
+    fflush(runLog); // a line per run, even if the shell is killed later
+}
+
+static int cmpStats(const void *a, const void *b) {
+    long long x = ((const GameStats *)a)->wallUs, y = ((const GameStats *)b)->wallUs;
+    return (y > x) - (y < x); // most wall time first
+}
+
+void printRunStats(FILE *out) {
+    qsort(stats, statsCount, sizeof(GameStats), cmpStats);
+    fprintf(out, "%-20s %6s %6s %10s %10s %10s %10s %10s\n", "game", "runs", "failed", "total ms", "mean ms", "max ms",
+            "cpu ms", "max KiB");
+    for (int i = 0; i < statsCount; i++) {
+        GameStats *entry = &stats[i];
+        fprintf(out, "%-20s %6d %6d %10.1f %10.1f %10.1f %10.1f %10ld\n", entry->game, entry->runs, entry->failures,
+                entry->wallUs / 1e3, entry->wallUs / 1e3 / entry->runs, entry->maxWallUs / 1e3, entry->cpuUs / 1e3,
+                entry->maxRssKb);
+    }
+    fflush(out);
+}
+
+void formatUsage(const RunUsage *usage, char *text, size_t size) {
+    snprintf(text, size, "real %.3fs user %.3fs sys %.3fs maxrss %ld KiB switches %ld+%ld", usage->wallUs / 1e6,
+             usage->userUs / 1e6, usage->sysUs / 1e6, usage->maxRssKb, usage->voluntarySwitches,
+             usage->involuntarySwitches);
+}
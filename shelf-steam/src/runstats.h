@@ -0,0 +1,35 @@
+#ifndef RUNSTATS_H
+#define RUNSTATS_H
+
+#include <stdio.h> // include standard input/output library
+#include <sys/resource.h> // include resource usage library
+
+// resources used by one game, or by a whole pipeline
+typedef struct {
+    long long wallUs; // from launch until the shell reaped it
+    long long userUs; // user CPU time
+    long long sysUs; // system CPU time
+    long maxRssKb; // peak resident set, the largest stage's for a pipeline
+    long voluntarySwitches; // context switches while waiting for something
+    long involuntarySwitches; // context switches forced by the scheduler
+} RunUsage;
+
+// add the CPU time, switches and peak memory of one process reaped through wait4
+void addUsage(RunUsage *total, const struct rusage *usage);
+
+// append a line per finished game to path, writing a header when the file is new; returns -1 on error
+int openRunLog(const char *path);
+
+// close the log and forget the stats table
+void closeRunStats(void);
+
+// count a finished game in the stats table and the log; status is its wait status
+void recordRun(const char *game, int status, const RunUsage *usage, const char *command);
+
+// print the stats table, games with the most wall time first
+void printRunStats(FILE *out);
+
+// one line summary of a run, for the optional line printed after every game
+void formatUsage(const RunUsage *usage, char *text, size_t size);
+
+#endif
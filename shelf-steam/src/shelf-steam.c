@@ -8,40 +8,150 @@
 #include <sys/types.h> // include system types library
 #include <sys/wait.h> // include wait library
 #include <fcntl.h> // include file control library
+#include <errno.h> // include error number library
+#include <poll.h> // include poll library
+#include <signal.h> // include signal library
+#include <time.h> // include time library
+#include <sys/mman.h> // include memory file library
+
+#include "gameindex.h" // include live game index
+#include "jobs.h" // include job control
+#include "spawn.h" // include game launcher
+#include "runstats.h" // include per-run resource accounting
+#include "zygote.h" // include pre-started launcher pool
 
 #define MAX_INPUT 255 // set max input size
+#define PROBE_JOBS 16 // games probed with --help at the same time
+#define PROBE_TIMEOUT_MS 2000 // probes still running after this are killed
+#define PROBE_REAP_MS 10 // how often to check on a probe that closed its output but has not exited
+#define MAX_BATCH_JOBS 64 // most command lines run at once with -j
+#define MAX_COMMAND 1024 // longest command line kept for jobs, longer ones are cut
+#define LS_PAGE_SIZE 100 // games per page of `ls <page>`
+#define INDEX_FILE ".shelf-steam-index" // catalog file kept in the repo directory, hidden from ls
 
 char errorMessage[ ] = "An error has occurred\n"; // error message
 char *repoPath = NULL;
+GameIndex gameIndex; // games in repoPath, kept current through inotify
+int captureOut = -1, captureErr = -1; // where the command being started writes in parallel batch mode
+int capturedJob = 0; // job started by the last captured command
+int showUsage = 0; // -t prints a resource summary after every foreground game
+
+// command line running in parallel batch mode, whose output is held until the lines before it are done
+typedef struct {
+    int job; // job running it, 0 if it failed before starting
+    int outFd; // memfd holding its stdout
+    int errFd; // memfd holding its stderr and shell errors
+} BatchSlot;
+
+// cached --help description of one game, valid while the binary is unchanged
+typedef struct {
+    char *name; // game file name
+    ino_t inode; // inode the description was probed from
+    off_t size; // size of the binary when probed
+    struct timespec mtime; // modification time of the binary when probed
+    char description[MAX_INPUT]; // formatted description line
+} CatalogEntry;
+
+CatalogEntry *catalog = NULL; // cached descriptions of repoPath, sorted by name
+int catalogCount = 0; // number of cached descriptions
 
 // function prototypes
+void runInteractive(FILE *in); // function to run the prompt loop
+void runBatch(FILE *in, int parallel); // function to run a script, up to parallel lines at once
+int isIndependent(const char *line); // function to check if a line may overlap with its neighbours
+void finishBatchSlot(BatchSlot *slot); // function to wait for a batch line and print its output
+void copyOutput(int fromFd, int toFd); // function to copy captured output
 void printPrompt(); // function to print prompt
 void parseAndRun(char *input); // function to parse and run input
 void exitHandler(char **args); // function to handle exit command
 void pathHandler(char **args); // function to handle path command
-void lsHandler(); // function to handle ls command
-int cmpFunc(const void *a, const void *b); // function to compare game names
-void getGameDescription(const char *gamePath, char *description); // function to get game description
-void runGame(char **args, char *inputRedirect); // function to run game
-void redirectInput(char **args, char *filename); // function to redirect input
+void lsHandler(int page); // function to handle ls command, page 0 lists everything
+void probeGames(char **gamePaths, char **descriptions, int count); // function to get game descriptions concurrently
+pid_t startProbe(const char *gamePath, int *fd); // function to start one --help probe
+long long monotonicMs(); // function to read the monotonic clock
+void formatDescription(const char *gamePath, char *description, ssize_t bytesRead); // function to format probe output
+void runCommand(char **args, int argCount); // function to run a game or pipeline, in the background with &
+void fgHandler(char **args); // function to handle fg command
+void waitHandler(char **args); // function to handle wait command
+int parseJobId(const char *text); // function to parse a job number
+void printUsage(const char *command, const RunUsage *usage, int fd); // function to print the -t summary of a run
 void errorAndContinue(); // function to handle errors
 int isDirectory(const char *path); // function to check if path is a directory
+void loadCatalog(); // function to load the description cache of repoPath
+void saveCatalog(); // function to persist the description cache of repoPath
+void freeCatalog(CatalogEntry *entries, int count); // function to free cached descriptions
+CatalogEntry *findCatalogEntry(const char *name); // function to look up a cached description
 
 
 int main(int argc, char *argv[]) {
-    if (argc != 2 || !isDirectory(argv[1])) { // check for correct num of arguments
+    if (argc > 1 && strcmp(argv[1], ZYGOTE_HELPER_ARG) == 0) zygoteHelperMain(); // pool helper, never returns
+    char *scriptPath = NULL; // -c file of commands
+    int parallel = 1; // command lines run at once in batch mode
+    int zygotes = 0; // -z helpers kept ready to launch games
+    char *logPath = NULL; // -l file every finished game is appended to
+    int opt;
+    while ((opt = getopt(argc, argv, "c:j:z:l:t")) != -1) { // options come before the repo path
+        if (opt == 'c') {
+            scriptPath = optarg;
+        } else if (opt == 'l') {
+            logPath = optarg;
+        } else if (opt == 't') {
+            showUsage = 1;
+        } else if (opt == 'j') {
+            parallel = atoi(optarg);
+        } else if (opt == 'z') {
+            zygotes = atoi(optarg);
+            if (zygotes <= 0) parallel = 0; // flag the error below
+        } else {
+            parallel = 0; // flag the error below
+        }
+    }
+    if (argc - optind != 1 || parallel <= 0 || !isDirectory(argv[optind])) { // check for correct num of arguments
+        errorAndContinue(); // handle error
+        exit(1); // exit with error
+    }
+    if (parallel > MAX_BATCH_JOBS) parallel = MAX_BATCH_JOBS;
+    FILE *in = scriptPath ? fopen(scriptPath, "r") : stdin; // where commands come from
+    if (!in || (logPath && openRunLog(logPath) != 0)) {
         errorAndContinue(); // handle error
         exit(1); // exit with error
     }
-    repoPath = strdup(argv[1]); // store game directory path
+
+    repoPath = strdup(argv[optind]); // store game directory path
+    if (openGameIndex(&gameIndex, repoPath) != 0) { // scan the repo once
+        errorAndContinue(); // handle error
+        exit(1); // exit with error
+    }
+    loadCatalog(); // reuse descriptions probed by earlier sessions
+    initJobs(); // collect finished games through SIGCHLD
+    if (zygotes > 0) startZygotes(zygotes); // without helpers games are spawned directly
+
+    if (scriptPath || !isatty(STDIN_FILENO)) { // scripts get no prompt and buffered output
+        runBatch(in, parallel);
+    } else {
+        runInteractive(in);
+    }
+
+    if (in != stdin) fclose(in); // close script
+    fflush(stdout); // flush buffered output
+    free(repoPath); // free repo path
+    freeCatalog(catalog, catalogCount); // free cached descriptions
+    closeGameIndex(&gameIndex); // stop watching the repo
+    stopZygotes(); // let idle helpers exit
+    closeRunStats(); // close the run log
+    return 0; // return success
+}
+
+void runInteractive(FILE *in) {
     char *input = NULL;
     size_t len = 0; 
     
     while (1) {
+        reportJobs(stdout, 0); // tell the user about background games that finished
+        refillZygotes(); // replace used helpers while the user types
         printPrompt();
-        if (getline(&input, &len, stdin) == -1) { // read input
-            free(input); // free input
-            break; // break on error
+        if (getline(&input, &len, in) == -1) { // read input
+            break; // break on error, input is freed below
         }
 
         char *trimmed = input; // trim input
@@ -52,9 +162,104 @@ int main(int argc, char *argv[]) {
         
         parseAndRun(trimmed); // parse and run input ignoring leading spaces
     }
-    free(repoPath); // free repo path
     free(input); // free input
-    return 0; // return success
+}
+
+void runBatch(FILE *in, int parallel) {
+    BatchSlot slots[MAX_BATCH_JOBS]; // lines in flight, oldest first from head
+    int head = 0, inFlight = 0;
+    char *input = NULL;
+    size_t len = 0;
+
+    while (getline(&input, &len, in) != -1) { // read input
+        char *trimmed = input; // trim input
+        while (*trimmed == ' ' || *trimmed == '\t' || *trimmed == '\n') { // trim leading spaces
+            trimmed++;
+        }
+        if (*trimmed == '\0') continue; // skip empty input
+        refillZygotes(); // replace helpers used by the previous line
+
+        BatchSlot slot = {0, -1, -1};
+        if (parallel > 1 && isIndependent(trimmed)) { // capture the output of games that can overlap
+            slot.outFd = memfd_create("shelf-steam-out", MFD_CLOEXEC);
+            slot.errFd = memfd_create("shelf-steam-err", MFD_CLOEXEC);
+        }
+        if (slot.outFd < 0 || slot.errFd < 0) { // builtins, & lines and anything else run in order on their own
+            if (slot.outFd >= 0) close(slot.outFd);
+            if (slot.errFd >= 0) close(slot.errFd);
+            while (inFlight > 0) { // everything before it must be done first
+                finishBatchSlot(&slots[head]);
+                head = (head + 1) % MAX_BATCH_JOBS;
+                inFlight--;
+            }
+            reportJobs(stdout, 0); // background games that finished
+            parseAndRun(trimmed); // parse and run input ignoring leading spaces
+            continue;
+        }
+
+        if (inFlight == parallel) { // make room, oldest first so output stays in order
+            finishBatchSlot(&slots[head]);
+            head = (head + 1) % MAX_BATCH_JOBS;
+            inFlight--;
+        }
+        captureOut = slot.outFd;
+        captureErr = slot.errFd;
+        capturedJob = 0;
+        parseAndRun(trimmed); // starts the game without waiting for it
+        slot.job = capturedJob;
+        captureOut = captureErr = -1;
+        slots[(head + inFlight++) % MAX_BATCH_JOBS] = slot;
+    }
+    while (inFlight > 0) { // drain the tail of the script
+        finishBatchSlot(&slots[head]);
+        head = (head + 1) % MAX_BATCH_JOBS;
+        inFlight--;
+    }
+    reportJobs(stdout, 0); // background games that finished
+    free(input); // free input
+}
+
+int isIndependent(const char *line) {
+    char copy[MAX_COMMAND]; // tokens of the line, the line itself is parsed later
+    snprintf(copy, sizeof(copy), "%s", line);
+    char *first = strtok(copy, " \t\n"); // first token
+    char *last = first; // last token
+    for (char *token = first; token; token = strtok(NULL, " \t\n")) last = token;
+    if (!first || strcmp(last, "&") == 0) return 0; // background jobs print their number at once
+    const char *builtins[] = {"exit", "path", "ls", "jobs", "fg", "wait", "stats"}; // these read or change shell state
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strcmp(first, builtins[i]) == 0) return 0;
+    }
+    return 1;
+}
+
+void finishBatchSlot(BatchSlot *slot) {
+    RunUsage usage;
+    char command[MAX_COMMAND] = ""; // kept for the summary, the job is forgotten once waited for
+    if (slot->job > 0) {
+        snprintf(command, sizeof(command), "%s", jobCommand(slot->job));
+        foregroundJob(slot->job, &usage); // wait for the game
+    }
+    fflush(stdout); // shell output so far goes first
+    copyOutput(slot->outFd, STDOUT_FILENO); // then the line's output, in one piece
+    copyOutput(slot->errFd, STDERR_FILENO);
+    if (slot->job > 0 && showUsage) printUsage(command, &usage, STDERR_FILENO);
+    close(slot->outFd);
+    close(slot->errFd);
+}
+
+void copyOutput(int fromFd, int toFd) {
+    char buffer[65536]; // chunk copied at once
+    lseek(fromFd, 0, SEEK_SET); // rewind the memfd
+    ssize_t n;
+    while ((n = read(fromFd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t done = 0; done < n; ) { // write it all, retrying short writes
+            ssize_t w = write(toFd, buffer + done, n - done);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return; // output closed
+            done += w;
+        }
+    }
 }
 
 
@@ -73,6 +278,10 @@ void parseAndRun (char *input) {
     int argCount = 0; // argument count
     char *token = strtok(input, " \t\n"); // tokenize input using whitespaces as delimiters
     while (token != NULL) { // loop through tokens
+        if (argCount == MAX_INPUT - 1) { // check for too many arguments
+            errorAndContinue();
+            return;
+        }
         args[argCount++] = token; // add token to args
         token = strtok(NULL, " \t\n"); // get next token
     }
@@ -82,9 +291,13 @@ void parseAndRun (char *input) {
     
     if (strcmp(args[0], "exit") == 0 ||
         strcmp(args[0], "path") == 0 ||
-        strcmp(args[0], "ls") == 0) {
+        strcmp(args[0], "ls") == 0 ||
+        strcmp(args[0], "jobs") == 0 ||
+        strcmp(args[0], "fg") == 0 ||
+        strcmp(args[0], "wait") == 0 ||
+        strcmp(args[0], "stats") == 0) {
         for (int i = 1; i < argCount; i++) {
-            if (strcmp(args[i], "<") == 0) { // redirection is not allowed for built-ins
+            if (strcmp(args[i], "<") == 0 || strcmp(args[i], "|") == 0 || strcmp(args[i], "&") == 0) { // redirection, pipes and & are not allowed for built-ins
                 errorAndContinue();
                 return;
             }
@@ -102,37 +315,42 @@ void parseAndRun (char *input) {
             }
             pathHandler(args);
         } else if (strcmp(args[0], "ls") == 0) {
+            char *end = NULL; // end of the page number
+            int page = argCount == 2 ? (int)strtol(args[1], &end, 10) : 0; // optional page of LS_PAGE_SIZE games
+            if (argCount > 2 || (argCount == 2 && (*end != '\0' || page <= 0))) {
+                errorAndContinue();
+                return;
+            }
+            lsHandler(page);
+        } else if (strcmp(args[0], "jobs") == 0) {
+            if (argCount != 1) {
+                errorAndContinue();
+                return;
+            }
+            reportJobs(stdout, 1); // list running and finished jobs
+        } else if (strcmp(args[0], "fg") == 0) {
+            if (argCount > 2) {
+                errorAndContinue();
+                return;
+            }
+            fgHandler(args);
+        } else if (strcmp(args[0], "wait") == 0) {
+            if (argCount > 2) {
+                errorAndContinue();
+                return;
+            }
+            waitHandler(args);
+        } else if (strcmp(args[0], "stats") == 0) {
             if (argCount != 1) {
                 errorAndContinue();
                 return;
             }
-            lsHandler();
+            printRunStats(stdout); // time and memory of every game run so far
         }
         return;
     }
 
-    int redirectFlag = 0; // flag for redirection
-    char *inputFile = NULL; // marker for input file
-    int redirectIndex = -1; // index of redirection operator
-    for (int i = 0; i < argCount; i++) { // loop through args
-        if (strcmp(args[i], "<") == 0) { // check for redirection operator
-            if (redirectFlag) { // check if redirection is already set
-                errorAndContinue(); // handle error
-                return; // return
-            }
-            redirectFlag = 1; // set flag
-            redirectIndex = i; // set index
-        }
-    }
-    if (redirectFlag) { // check if redirection is set
-        if (redirectIndex != argCount - 2) { // check if redirection operator is first
-            errorAndContinue(); // handle error
-            return; // return
-        }
-        inputFile = args[redirectIndex + 1]; // get input file
-        args[redirectIndex] = NULL; // set redirection operator to NULL
-    }
-    runGame(args, inputFile); // run game
+    runCommand(args, argCount); // run game or pipeline
 }
 
 void exitHandler(char **args) {
@@ -148,100 +366,214 @@ void pathHandler(char **args) {
         errorAndContinue(); // handle error
         return; // return
     }
+    GameIndex newIndex; // index of the new repo
+    if (openGameIndex(&newIndex, args[1]) != 0) { // check if the new repo can be read
+        errorAndContinue(); // handle error
+        return;
+    }
+    closeGameIndex(&gameIndex); // stop watching the previous repo
+    gameIndex = newIndex;
     free(repoPath); // free previous repo path
     repoPath = strdup(args[1]); // set new repo path
-    
+    loadCatalog(); // switch to the cache of the new repo
 }
 
-void lsHandler() {
-    DIR *dir = opendir(repoPath); // open directory
-    if (!dir) { // check if directory is valid
+void lsHandler(int page) {
+    if (syncGameIndex(&gameIndex) != 0) { // catch up with changes to the repo
         errorAndContinue(); // handle error 
         return;
     }
-    // allocate array to hold game names
-    int capacity = 10; 
-    int count = 0;
-    char **gameNames = malloc(capacity * sizeof(char *)); // allocate memory for game names
-    if (!gameNames) { // check if memory allocation failed
-        closedir(dir); // close directory
+    int count = gameIndex.count; // games in the repo
+    GameEntry *games = gameIndex.games; // games sorted by name
+    int first = 0, last = count; // range of games to show
+    int pages = (count + LS_PAGE_SIZE - 1) / LS_PAGE_SIZE; // pages in the listing
+    if (page > (pages > 0 ? pages : 1)) { // past the end of the listing, an empty repo still has page 1
         errorAndContinue(); // handle error
-        return; // return
+        return;
+    }
+    if (page > 0) { // only stat and probe the requested page
+        first = (page - 1) * LS_PAGE_SIZE < count ? (page - 1) * LS_PAGE_SIZE : count;
+        last = first + LS_PAGE_SIZE < count ? first + LS_PAGE_SIZE : count;
+    }
+    int shown = last - first; // games on this page
+
+    char (*descriptions)[MAX_INPUT] = calloc(shown > 0 ? shown : 1, MAX_INPUT); // description of every game shown
+    char **probePaths = calloc(shown > 0 ? shown : 1, sizeof(char *)); // games whose cache entry is stale
+    char **probeOutputs = calloc(shown > 0 ? shown : 1, sizeof(char *)); // where each probe writes its description
+    if (!descriptions || !probePaths || !probeOutputs) { // check if memory allocation failed
+        free(descriptions);
+        free(probePaths);
+        free(probeOutputs);
+        errorAndContinue(); // handle error
+        return;
     }
 
-    struct dirent *entry; // struct to hold directory entry
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') continue; 
-        char gamePath[512]; // array to hold game path
-        snprintf(gamePath, sizeof(gamePath), "%s/%s", repoPath, entry->d_name); // create game path
-        
-        struct stat pathStat; // struct to hold path status
-        if (stat(gamePath, &pathStat) != 0) continue; // continue to next entry
-        if (S_ISDIR(pathStat.st_mode)) continue; // check if entry is a directory
-
-        char *nameCopy = strdup(entry->d_name); // duplicate game name
-        if (!nameCopy) continue; // check if memory allocation failed
-        if (count >= capacity) { // check if capacity is reached
-            capacity *= 2; // double capacity
-            char **temp = realloc(gameNames, capacity * sizeof(char *)); // reallocate memory for game names
-            if (!temp) {
-                free(nameCopy); // free name copy
-                continue; // continue to next entry
-            }
-            gameNames = temp; // set new game names
+    int probeCount = 0; // games to run with --help
+    for (int i = first; i < last; i++) { // loop through game names
+        char *description = descriptions[i - first];
+        if (statGame(&gameIndex, &games[i]) != 0) { // removed since the last sync
+            description[0] = '\0'; // skipped when printing
+            continue;
         }
-        gameNames[count++] = nameCopy; // add game name to array
+        CatalogEntry *cached = findCatalogEntry(games[i].name); // previous probe of this name
+        if (cached && cached->inode == games[i].inode && cached->size == games[i].size &&
+            cached->mtime.tv_sec == games[i].mtime.tv_sec && cached->mtime.tv_nsec == games[i].mtime.tv_nsec) {
+            strcpy(description, cached->description); // unchanged binary, no need to run it
+            continue;
+        }
+        probePaths[probeCount] = gamePathOf(&gameIndex, games[i].name); // new or rebuilt game
+        if (!probePaths[probeCount]) {
+            strcpy(description, "(empty)"); // handle error
+            continue;
+        }
+        probeOutputs[probeCount++] = description;
     }
-    closedir(dir); // close directory
 
-    qsort(gameNames, count, sizeof(char *), cmpFunc); // sort game names
+    probeGames(probePaths, probeOutputs, probeCount); // run every stale game at once
+    for (int i = 0; i < probeCount; i++) free(probePaths[i]); // free probe paths
 
-    for (int i = 0; i < count; i++) { // loop through game names
-        char gamePath[512]; // array to hold game path
-        snprintf(gamePath, sizeof(gamePath), "%s/%s", repoPath, gameNames[i]); // create game path
-        char description[MAX_INPUT]; // variable to hold description
-        getGameDescription(gamePath, description); // get game description
-        printf("%s: %s\n", gameNames[i], description); // print game name and description
-        fflush(stdout); // flush output
-        free(gameNames[i]); // free game name
+    for (int i = first; i < last; i++) { // print in sorted order
+        if (games[i].hasStat) printf("%s: %s\n", games[i].name, descriptions[i - first]); // print game name and description
     }
+    if (page > 0) printf("(page %d of %d)\n", page, pages > 0 ? pages : 1); // tell the user how far the listing goes
+    fflush(stdout); // flush output
+
+    if (probeCount > 0 || (page == 0 && count != catalogCount)) { // otherwise the cache already matches the repo
+        CatalogEntry *fresh = calloc(count > 0 ? count : 1, sizeof(CatalogEntry)); // cache rebuilt from this listing
+        int freshCount = 0; // entries copied into the new cache
+        for (int i = 0; fresh && i < count; i++) { // remember the description for the next ls
+            CatalogEntry *entry = &fresh[freshCount];
+            CatalogEntry *cached = findCatalogEntry(games[i].name); // games on other pages keep their old entry
+            if (i >= first && i < last && games[i].hasStat) {
+                entry->inode = games[i].inode;
+                entry->size = games[i].size;
+                entry->mtime = games[i].mtime;
+                strcpy(entry->description, descriptions[i - first]);
+            } else if (cached) {
+                *entry = *cached;
+            } else {
+                continue; // not probed yet
+            }
+            entry->name = strdup(games[i].name); // duplicate game name
+            if (entry->name) freshCount++;
+        }
+        if (fresh) { // drop games that disappeared since the last listing
+            freeCatalog(catalog, catalogCount);
+            catalog = fresh;
+            catalogCount = freshCount;
+            saveCatalog(); // only rewrite the index when something changed
+        }
+    }
+    free(descriptions);
+    free(probePaths);
+    free(probeOutputs);
 }
 
-int cmpFunc(const void *a, const void *b) { // sort the game names
-    const char *nameA = *(const char **)a;
-    const char *nameB = *(const char **)b;
-    return strcmp(nameA, nameB);
+// a running --help probe
+typedef struct {
+    pid_t pid; // probe process, 0 once reaped
+    int fd; // read end of its output pipe, -1 once drained
+    int slot; // index into the caller's arrays
+    ssize_t bytesRead; // output kept so far
+    long long deadline; // CLOCK_MONOTONIC milliseconds after which it is killed
+} Probe;
+
+void probeGames(char **gamePaths, char **descriptions, int count) {
+    Probe running[PROBE_JOBS]; // probes in flight
+    struct pollfd fds[PROBE_JOBS]; // pipes of the probes in flight
+    int active = 0, next = 0; // probes in flight, next game to start
+
+    while (active > 0 || next < count) {
+        while (active < PROBE_JOBS && next < count) { // keep up to PROBE_JOBS games running
+            Probe *probe = &running[active];
+            probe->slot = next++;
+            probe->bytesRead = 0;
+            probe->pid = startProbe(gamePaths[probe->slot], &probe->fd);
+            if (probe->pid < 0) { // could not start it
+                strcpy(descriptions[probe->slot], "(empty)"); // handle error
+                continue;
+            }
+            probe->deadline = monotonicMs() + PROBE_TIMEOUT_MS;
+            active++;
+        }
+        if (active == 0) break;
+
+        long long now = monotonicMs(); // current time
+        int timeout = PROBE_TIMEOUT_MS; // poll until the nearest deadline
+        for (int i = 0; i < active; i++) {
+            long long left = running[i].deadline - now;
+            if (running[i].fd < 0) left = left < PROBE_REAP_MS ? left : PROBE_REAP_MS; // output done, check back for the exit
+            if (left < timeout) timeout = left < 0 ? 0 : (int)left;
+            fds[i].fd = running[i].fd; // negative fds are ignored by poll
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        if (poll(fds, active, timeout) < 0 && errno != EINTR) { // wait for output or a deadline
+            for (int i = 0; i < active; i++) running[i].deadline = now; // give up on every probe in flight
+        }
+
+        now = monotonicMs();
+        for (int i = 0; i < active; i++) {
+            Probe *probe = &running[i];
+            char *description = descriptions[probe->slot];
+            if (probe->fd >= 0 && fds[i].revents) { // output or hang-up
+                char discard[4096]; // output past the first MAX_INPUT - 1 bytes is not needed
+                ssize_t room = MAX_INPUT - 1 - probe->bytesRead;
+                ssize_t n = room > 0 ? read(probe->fd, description + probe->bytesRead, room) : read(probe->fd, discard, sizeof(discard));
+                if (n > 0 && room > 0) probe->bytesRead += n;
+                if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN)) { // end of output
+                    close(probe->fd);
+                    probe->fd = -1;
+                }
+            }
+            if (probe->fd < 0 && waitpid(probe->pid, NULL, WNOHANG) == probe->pid) probe->pid = 0; // exited on its own
+            if (probe->pid > 0 && now >= probe->deadline) { // hung or too slow, keep whatever it printed
+                kill(probe->pid, SIGKILL);
+                waitpid(probe->pid, NULL, 0);
+                probe->pid = 0;
+            }
+            if (probe->pid == 0) { // finished
+                if (probe->fd >= 0) close(probe->fd);
+                formatDescription(gamePaths[probe->slot], description, probe->bytesRead);
+                running[i] = running[--active]; // fill the gap with the last probe
+                fds[i] = fds[active];
+                i--; // revisit the probe moved into this slot
+            }
+        }
+    }
 }
 
-void getGameDescription(const char *gamePath, char *description) {
+pid_t startProbe(const char *gamePath, int *fd) {
     int pipefd[2]; // array to hold pipe file descriptors
-    if (pipe(pipefd) == -1) { // create pipe
-        strcpy(description, "(empty)"); // handle error
-        return;
+    if (pipe2(pipefd, O_CLOEXEC) == -1) { // create pipe, hidden from the other probes
+        return -1;
     }
 
-    pid_t pid = fork(); // fork process
-    if (pid < 0) { // check if fork failed
-        strcpy(description, "(empty)"); // handle error
-        return;
-    }
-
-    if (pid == 0) { // check if child process
-        close(pipefd[0]); // close read end of pipe
-        dup2(pipefd[1], STDOUT_FILENO); // redirect stdout to pipe
-        dup2(pipefd[1], STDERR_FILENO); // close write end of pipe
-        close(pipefd[1]); // close write end of pipe
-
-        execl(gamePath, strrchr(gamePath, '/') + 1, "--help", NULL); // execute file command
-        exit(1); // exit with error
+    char *argv[] = {strrchr(gamePath, '/') + 1, "--help", NULL}; // probe arguments
+    SpawnIo io = SPAWN_IO_INHERIT; // output goes to the pipe, probes must not read the shell's input
+    io.inputFile = "/dev/null";
+    io.outFd = pipefd[1];
+    io.errFd = pipefd[1];
+    pid_t pid = spawnGame(gamePath, argv, &io);
+    if (pid < 0) { // check if spawn failed
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
     }
 
     close(pipefd[1]); // close write end of pipe
-    wait(NULL); // wait for child process
+    fcntl(pipefd[0], F_SETFL, O_NONBLOCK); // never block on one probe while others have output
+    *fd = pipefd[0];
+    return pid;
+}
 
-    ssize_t bytesRead = read(pipefd[0], description, MAX_INPUT - 1); // read from pipe
-    close(pipefd[0]); // close read end of pipe
+long long monotonicMs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
+void formatDescription(const char *gamePath, char *description, ssize_t bytesRead) {
     if (bytesRead > 0) {
         description[bytesRead] = '\0';
         description[strcspn(description, "\n")] = '\0'; 
@@ -268,75 +600,225 @@ void getGameDescription(const char *gamePath, char *description) {
 }
 
 
-void runGame(char **args, char *inputRedirect) {
-    if (!repoPath || !args[0]) { // check if repo path is NULL or game name is NULL
-        errorAndContinue(); // handle error
-        return;
+void runCommand(char **args, int argCount) {
+    char command[MAX_COMMAND]; // command line as typed, for jobs and notifications
+    command[0] = '\0';
+    for (int i = 0; i < argCount; i++) { // rebuild it before the tokens are split up
+        size_t used = strlen(command);
+        snprintf(command + used, sizeof(command) - used, i > 0 ? " %s" : "%s", args[i]);
+    }
+
+    int background = 0; // flag for &
+    if (strcmp(args[argCount - 1], "&") == 0) { // & must come last
+        background = 1;
+        args[--argCount] = NULL;
     }
 
-    char gamePath[512]; // array to hold game path
-    snprintf(gamePath, sizeof(gamePath), "%s/%s", repoPath, args[0]); // create game path
+    char **stageArgs[MAX_INPUT]; // first argument of every pipeline stage
+    int stages = 0; // games in the pipeline
+    char *inputFile = NULL; // marker for input file
+    int stageStart = 0; // index of the current stage's first argument
+    for (int i = 0; i <= argCount; i++) { // loop through args, a NULL ends the last stage
+        if (i < argCount && strcmp(args[i], "|") != 0) {
+            if (strcmp(args[i], "&") == 0) { // & anywhere but the end
+                errorAndContinue(); // handle error
+                return;
+            }
+            if (strcmp(args[i], "<") != 0) continue;
+            int endsStage = i + 2 == argCount || (i + 2 < argCount && strcmp(args[i + 2], "|") == 0); // < file must end the stage
+            if (i == stageStart || stages != 0 || inputFile || !endsStage || strcmp(args[i + 1], "|") == 0) { // needs a game, and only the first stage reads a file
+                errorAndContinue(); // handle error
+                return;
+            }
+            inputFile = args[i + 1]; // get input file
+            args[i] = NULL; // set redirection operator to NULL
+            i++; // skip the file name
+            continue;
+        }
+        if (i == stageStart || !args[stageStart]) { // empty stage, as in "a | | b" or "< file"
+            errorAndContinue(); // handle error
+            return;
+        }
+        args[i] = NULL; // end this stage's arguments
+        stageArgs[stages++] = &args[stageStart];
+        stageStart = i + 1;
+    }
 
-    if (access(gamePath, X_OK) != 0) { // check if game is executable
+    if (syncGameIndex(&gameIndex) != 0) { // catch up with changes to the repo
         errorAndContinue(); // handle error
         return;
     }
-
-    pid_t pid = fork(); // fork process
-    if (pid < 0) { // check if fork failed
-        errorAndContinue(); // print error message
-        return; 
-    }
-    if (pid == 0) { // check if child process
-        if (inputRedirect) {
-            int fd = open(inputRedirect, O_RDONLY); // open file for reading
-            if (fd == -1) { // check if file descriptor is invalid
-                errorAndContinue(); // print error message
-                exit(1); // exit with error
-            }
-            dup2(fd, STDIN_FILENO); // duplicate file descriptor to redirect input
-            close(fd); // close file descriptor
+    char *gamePaths[MAX_INPUT]; // path of every stage's game
+    for (int i = 0; i < stages; i++) {
+        GameEntry *game = findGame(&gameIndex, stageArgs[i][0]); // look the game up in memory
+        int ok = game && statGame(&gameIndex, game) == 0 && (game->mode & (S_IXUSR | S_IXGRP | S_IXOTH)); // check if game is executable
+        gamePaths[i] = ok ? gamePathOf(&gameIndex, stageArgs[i][0]) : NULL; // create game path
+        if (!gamePaths[i]) {
+            for (int j = 0; j < i; j++) free(gamePaths[j]);
+            errorAndContinue(); // handle error
+            return;
         }
-        execvp(gamePath, args); // execute game
+    }
+
+    int failed = 0; // stages that could not start
+    fflush(stdout); // games write straight to the descriptor, keep earlier output ahead of theirs
+    int id = startJob(gamePaths, stageArgs, stages, inputFile, command, background,
+                      captureOut, captureErr, &failed); // start every stage at once
+    for (int i = 0; i < stages; i++) free(gamePaths[i]); // free game paths
+    if (failed > 0) { // check if spawn failed or the input file could not be opened
         errorAndContinue(); // print error message
-        exit(1); // exit with error
-    } else { // parent process
-        wait(NULL); // wait for child process
+    }
+    if (id < 0) return;
+    if (captureOut >= 0) { // parallel batch mode waits for it later
+        capturedJob = id;
+    } else if (background) {
+        printf("[%d] %d\n", id, (int)jobPid(id)); // job number and pid, like a shell
+        fflush(stdout);
+    } else {
+        RunUsage usage;
+        foregroundJob(id, &usage); // wait for the game without blocking in wait()
+        if (showUsage) printUsage(command, &usage, STDERR_FILENO);
     }
 }
 
-void redirectInput(char **args, char *filename) {
-    int fd = open(filename, O_RDONLY); // open file for reading
-    if (fd == -1) { // check if file descriptor is invalid
-        errorAndContinue(); // print error message
+void fgHandler(char **args) {
+    int id = args[1] ? parseJobId(args[1]) : lastJob(); // default to the most recent job
+    const char *command = id > 0 ? jobCommand(id) : NULL; // command line of the job
+    if (!command) { // check if the job exists
+        errorAndContinue(); // handle error
         return;
     }
+    printf("%s\n", command); // show what is being brought back, like a shell
+    fflush(stdout);
+    char copy[MAX_COMMAND]; // kept for the summary, the job is forgotten once waited for
+    snprintf(copy, sizeof(copy), "%s", command);
+    RunUsage usage;
+    foregroundJob(id, &usage);
+    if (showUsage) printUsage(copy, &usage, STDERR_FILENO);
+}
 
-    pid_t pid = fork(); // fork process
-    if (pid < 0) { // check if fork failed
-        errorAndContinue(); // print error message
-        close(fd); // close file descriptor
-        return; 
+void waitHandler(char **args) {
+    int id = args[1] ? parseJobId(args[1]) : 0; // 0 waits for every job
+    if (id < 0 || waitJobs(id) != 0) { // check if the job exists
+        errorAndContinue(); // handle error
+        return;
     }
+    reportJobs(stdout, 0); // print what finished
+}
 
-    if (pid == 0) { // check if child process
-        dup2(fd, STDIN_FILENO); // duplicate file descriptor to redirect input
-        close(fd); // close file descriptor
-        execvp(args[0], args); // execute game
-        errorAndContinue(); // print error message
-        exit(1); // exit with error
-    } else { // parent process
-        close(fd); // close file descriptor
-        wait(NULL); // wait for child process
-    }
+void printUsage(const char *command, const RunUsage *usage, int fd) {
+    char line[MAX_COMMAND + 128]; // command, then its summary
+    char summary[128];
+    formatUsage(usage, summary, sizeof(summary));
+    int len = snprintf(line, sizeof(line), "%s: %s\n", command, summary);
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    fflush(stdout); // keep the summary after the game's output
+    write(fd, line, len);
+}
+
+int parseJobId(const char *text) {
+    if (text[0] == '%') text++; // %n, as in other shells
+    char *end = NULL;
+    long id = strtol(text, &end, 10);
+    return end == text || *end != '\0' || id <= 0 || id > 1000000 ? -1 : (int)id;
 }
 
 void errorAndContinue() {
-    write(STDERR_FILENO, errorMessage, strlen(errorMessage)); // print error message
+    fflush(stdout); // keep the error after the output that came before it
+    write(captureErr >= 0 ? captureErr : STDERR_FILENO, errorMessage, strlen(errorMessage)); // print error message
     fflush(stderr); // flush error output
 }
 
 int isDirectory(const char *path) { 
     struct stat pathStat; // struct to hold path status
     return (stat(path, &pathStat) == 0 && S_ISDIR(pathStat.st_mode)); // check if path is a directory
-}
\ No newline at end of file
+}
+
+void freeCatalog(CatalogEntry *entries, int count) {
+    for (int i = 0; i < count; i++) {
+        free(entries[i].name); // free cached name
+    }
+    free(entries); // free cache array
+}
+
+CatalogEntry *findCatalogEntry(const char *name) {
+    int lo = 0, hi = catalogCount - 1; // the cache is kept in ls order
+    while (lo <= hi) { // binary search by name
+        int mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(catalog[mid].name, name);
+        if (cmp == 0) return &catalog[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return NULL; // never probed
+}
+
+void loadCatalog() {
+    freeCatalog(catalog, catalogCount); // forget the previous repo
+    catalog = NULL;
+    catalogCount = 0;
+
+    char *indexPath = gamePathOf(&gameIndex, INDEX_FILE); // create index path
+    FILE *file = indexPath ? fopen(indexPath, "r") : NULL; // open index file
+    free(indexPath); // free index path
+    if (!file) return; // no index yet, the first ls probes everything
+
+    int capacity = 0; // allocated cache entries
+    char *line = NULL;
+    size_t len = 0;
+    while (getline(&line, &len, file) != -1) { // one game per line: inode size sec nsec namelen name description
+        unsigned long long inode;
+        long long size, sec, nsec;
+        int nameLen, used; // name length and header length
+        if (sscanf(line, "%llu %lld %lld %lld %d %n", &inode, &size, &sec, &nsec, &nameLen, &used) != 5) break; // corrupt index
+        size_t lineLen = strlen(line); // length of the line
+        if (nameLen <= 0 || (size_t)(used + nameLen) >= lineLen || line[used + nameLen] != ' ') break; // truncated line
+        if (lineLen > 0 && line[lineLen - 1] == '\n') line[--lineLen] = '\0'; // remove newline
+
+        if (catalogCount >= capacity) { // check if capacity is reached
+            capacity = capacity ? capacity * 2 : 16; // double capacity
+            CatalogEntry *temp = realloc(catalog, capacity * sizeof(CatalogEntry)); // grow the cache
+            if (!temp) break; // keep what was read so far
+            catalog = temp;
+        }
+        CatalogEntry *entry = &catalog[catalogCount];
+        entry->name = strndup(line + used, nameLen); // duplicate game name
+        if (!entry->name) break;
+        if (catalogCount > 0 && strcmp(catalog[catalogCount - 1].name, entry->name) >= 0) { // index must stay sorted for lookups
+            free(entry->name);
+            break;
+        }
+        entry->inode = (ino_t)inode;
+        entry->size = (off_t)size;
+        entry->mtime.tv_sec = (time_t)sec;
+        entry->mtime.tv_nsec = (long)nsec;
+        snprintf(entry->description, MAX_INPUT, "%s", line + used + nameLen + 1); // copy description
+        catalogCount++;
+    }
+    free(line); // free line buffer
+    fclose(file); // close index file
+}
+
+void saveCatalog() {
+    char *indexPath = gamePathOf(&gameIndex, INDEX_FILE); // create index path
+    char *tempPath = gamePathOf(&gameIndex, INDEX_FILE ".tmp"); // create temporary index path
+    FILE *file = indexPath && tempPath ? fopen(tempPath, "w") : NULL; // write a new index next to the old one
+    if (!file) { // read-only repo, keep the cache in memory only
+        free(indexPath);
+        free(tempPath);
+        return;
+    }
+
+    for (int i = 0; i < catalogCount; i++) { // one game per line
+        CatalogEntry *entry = &catalog[i];
+        if (strchr(entry->name, '\n')) continue; // such names cannot be stored line by line, probe them again next session
+        fprintf(file, "%llu %lld %lld %lld %d %s %s\n", (unsigned long long)entry->inode, (long long)entry->size,
+                (long long)entry->mtime.tv_sec, (long long)entry->mtime.tv_nsec, (int)strlen(entry->name),
+                entry->name, entry->description);
+    }
+    if (fclose(file) != 0 || rename(tempPath, indexPath) != 0) { // replace the index atomically
+        unlink(tempPath); // drop the partial index
+    }
+    free(indexPath);
+    free(tempPath);
+}
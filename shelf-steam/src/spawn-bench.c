@@ -0,0 +1,136 @@
+#define _GNU_SOURCE // enable GNU extensions
+#include <stdio.h> // include standard input/output library
+#include <stdlib.h> // include standard library
+#include <string.h> // include string library
+#include <unistd.h> // include unix standard library
+#include <fcntl.h> // include file control library
+#include <sys/wait.h> // include wait library
+#include <time.h> // include time library
+
+#include "spawn.h" // include game launcher
+#include "zygote.h" // include pre-started launcher pool
+
+#define DEFAULT_LAUNCHES 200 // launches timed per launcher and heap size
+#define MAX_HEAPS 16 // heap sizes accepted by -m
+#define BENCH_ZYGOTES 4 // helpers kept ready for the zygote launcher
+#define THINK_US 5000 // pause between launches, for every launcher alike
+
+typedef pid_t (*Launcher)(const char *path, char *const argv[], const SpawnIo *io);
+
+double nowUs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+int cmpDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// time launching and reaping the program, or with firstOutput until its first byte of output,
+// return the median in microseconds
+double timeLaunches(Launcher launch, const char *path, int launches, int firstOutput, double *mean) {
+    double *samples = malloc(launches * sizeof(double)); // one latency per launch
+    char *argv[] = {(char *)path, "x", NULL}; // echo needs something to print
+    double total = 0;
+    for (int i = 0; i < launches; i++) {
+        int pipefd[2] = {-1, -1};
+        if (firstOutput && pipe2(pipefd, O_CLOEXEC) != 0) {
+            perror("Failed to create a pipe");
+            exit(EXIT_FAILURE);
+        }
+        double start = nowUs();
+        SpawnIo io = SPAWN_IO_INHERIT;
+        io.inputFile = "/dev/null"; // same redirection a probe uses
+        io.outFd = pipefd[1];
+        pid_t pid = launch(path, argv, &io);
+        if (pid < 0) {
+            perror(path);
+            exit(EXIT_FAILURE);
+        }
+        if (firstOutput) { // the user sees the game once it writes, not once it exits
+            char byte;
+            close(pipefd[1]);
+            if (read(pipefd[0], &byte, 1) != 1) {
+                fprintf(stderr, "%s wrote nothing\n", path);
+                exit(EXIT_FAILURE);
+            }
+            samples[i] = nowUs() - start;
+            close(pipefd[0]);
+            waitpid(pid, NULL, 0);
+        } else {
+            waitpid(pid, NULL, 0);
+            samples[i] = nowUs() - start;
+        }
+        total += samples[i];
+        refillZygotes(); // the shell refills between prompts, outside the measured launch
+        usleep(THINK_US); // let new helpers settle in recvmsg, as they would while the user types
+    }
+    qsort(samples, launches, sizeof(double), cmpDouble);
+    double median = samples[launches / 2];
+    free(samples);
+    *mean = total / launches;
+    return median;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], ZYGOTE_HELPER_ARG) == 0) zygoteHelperMain(); // pool helper, never returns
+    int launches = DEFAULT_LAUNCHES; // launches per measurement
+    long heaps[MAX_HEAPS] = {0, 64, 256, 1024}; // MiB of touched memory the shell holds
+    int numHeaps = 4;
+    const char *program = NULL; // cheapest program to launch
+    int firstOutput = 0; // time until the first byte of output instead of until exit
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:o")) != -1) {
+        if (opt == 'o') {
+            firstOutput = 1;
+        } else if (opt == 'n') {
+            launches = atoi(optarg);
+        } else if (opt == 'm') { // comma separated MiB list
+            numHeaps = 0;
+            for (char *tok = strtok(optarg, ","); tok && numHeaps < MAX_HEAPS; tok = strtok(NULL, ",")) {
+                heaps[numHeaps++] = atol(tok);
+            }
+        } else {
+            numHeaps = 0;
+            break;
+        }
+    }
+    if (optind < argc) program = argv[optind++];
+    if (launches <= 0 || numHeaps == 0 || optind != argc) {
+        fprintf(stderr, "usage: %s [-o] [-n launches] [-m MiB,...] [program]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!program) program = firstOutput ? "/bin/echo" : "/bin/true";
+    if (startZygotes(BENCH_ZYGOTES) != 0) {
+        perror("Failed to start the zygote pool");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %14s %14s %14s %14s %14s %14s\n", "heap MiB", "fork p50 us", "fork mean us", "spawn p50 us",
+           "spawn mean us", "zygote p50 us", "zygote mean us");
+    char *heap = NULL; // memory the parent has touched, standing in for catalogs and caches
+    for (int h = 0; h < numHeaps; h++) {
+        size_t bytes = (size_t)heaps[h] << 20;
+        free(heap);
+        heap = bytes ? malloc(bytes) : NULL;
+        if (bytes && !heap) {
+            perror("Failed to allocate the heap");
+            return EXIT_FAILURE;
+        }
+        if (bytes) memset(heap, 1, bytes); // fault every page in so fork has page tables to copy
+
+        double forkMean, spawnMean, zygoteMean;
+        double forkMedian = timeLaunches(forkGame, program, launches, firstOutput, &forkMean);
+        double spawnMedian = timeLaunches(spawnGame, program, launches, firstOutput, &spawnMean);
+        double zygoteMedian = timeLaunches(zygoteSpawn, program, launches, firstOutput, &zygoteMean);
+        printf("%-10ld %14.1f %14.1f %14.1f %14.1f %14.1f %14.1f\n", heaps[h], forkMedian, forkMean, spawnMedian,
+               spawnMean, zygoteMedian, zygoteMean);
+        fflush(stdout);
+    }
+    free(heap);
+    stopZygotes();
+    return 0;
+}
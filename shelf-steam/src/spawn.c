@@ -0,0 +1,105 @@
+#define _GNU_SOURCE // enable GNU extensions
+#include <errno.h> // include error number library
+#include <fcntl.h> // include file control library
+#include <signal.h> // include signal library
+#include <spawn.h> // include posix spawn library
+#include <unistd.h> // include unix standard library
+#include <sys/wait.h> // include wait library
+
+#include "spawn.h"
+
+extern char **environ; // environment passed on to every game
+
+// queue the redirections of io as file actions
+static int addFileActions(posix_spawn_file_actions_t *actions, const SpawnIo *io) {
+    int err = 0;
+    if (io->inputFile) {
+        err = posix_spawn_file_actions_addopen(actions, STDIN_FILENO, io->inputFile, O_RDONLY, 0); // < redirection
+    } else if (io->inFd >= 0) {
+        err = posix_spawn_file_actions_adddup2(actions, io->inFd, STDIN_FILENO); // read from the previous stage
+    }
+    if (err == 0 && io->outFd >= 0) err = posix_spawn_file_actions_adddup2(actions, io->outFd, STDOUT_FILENO); // redirect stdout
+    if (err == 0 && io->errFd >= 0) err = posix_spawn_file_actions_adddup2(actions, io->errFd, STDERR_FILENO); // redirect stderr
+    return err;
+}
+
+pid_t spawnGame(const char *path, char *const argv[], const SpawnIo *io) {
+    posix_spawn_file_actions_t actions; // redirections applied in the child before exec
+    posix_spawnattr_t attr; // signal mask and process group of the child
+    int err = posix_spawn_file_actions_init(&actions);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    err = posix_spawnattr_init(&attr);
+    if (err != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        errno = err;
+        return -1;
+    }
+
+    sigset_t none; // the shell blocks SIGCHLD, games must not inherit that
+    sigemptyset(&none);
+    short flags = POSIX_SPAWN_SETSIGMASK;
+    posix_spawnattr_setsigmask(&attr, &none);
+    if (io->pgid >= 0) { // background jobs get their own group, out of reach of the terminal's ^C
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, io->pgid);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+    err = addFileActions(&actions, io);
+
+    pid_t pid = -1;
+    if (err == 0) {
+        err = posix_spawn(&pid, path, &actions, &attr, argv, environ); // glibc shares the parent's memory until exec
+    }
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) { // bad redirection or exec failure, reported by posix_spawn itself
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+pid_t forkGame(const char *path, char *const argv[], const SpawnIo *io) {
+    int errPipe[2]; // carries the child's errno if exec fails
+    if (pipe2(errPipe, O_CLOEXEC) == -1) return -1;
+
+    pid_t pid = fork(); // fork process
+    if (pid < 0) { // check if fork failed
+        close(errPipe[0]);
+        close(errPipe[1]);
+        return -1;
+    }
+    if (pid == 0) { // check if child process
+        sigset_t none; // the shell blocks SIGCHLD, games must not inherit that
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL);
+        if (io->pgid >= 0 && setpgid(0, io->pgid) == -1) goto fail;
+        if (io->inputFile) {
+            int fd = open(io->inputFile, O_RDONLY); // open file for reading
+            if (fd == -1 || dup2(fd, STDIN_FILENO) == -1) goto fail;
+            close(fd); // close file descriptor
+        } else if (io->inFd >= 0 && dup2(io->inFd, STDIN_FILENO) == -1) {
+            goto fail;
+        }
+        if (io->outFd >= 0 && dup2(io->outFd, STDOUT_FILENO) == -1) goto fail;
+        if (io->errFd >= 0 && dup2(io->errFd, STDERR_FILENO) == -1) goto fail;
+        execv(path, argv); // execute game
+    fail:
+        write(errPipe[1], &errno, sizeof(errno)); // report why the game did not start
+        _exit(127); // exit with error
+    }
+
+    close(errPipe[1]); // close write end of pipe
+    int childErr = 0;
+    ssize_t n = read(errPipe[0], &childErr, sizeof(childErr)); // closes on exec, so nothing means success
+    close(errPipe[0]);
+    if (n == sizeof(childErr)) {
+        waitpid(pid, NULL, 0); // reap the failed child
+        errno = childErr;
+        return -1;
+    }
+    return pid;
+}
@@ -0,0 +1,26 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <sys/types.h> // include system types library
+
+// where a game's standard streams come from, and which process group it joins
+typedef struct {
+    const char *inputFile; // opened as stdin when not NULL (< redirection)
+    int inFd; // dup'ed onto stdin when >= 0 and there is no inputFile
+    int outFd; // dup'ed onto stdout when >= 0
+    int errFd; // dup'ed onto stderr when >= 0
+    pid_t pgid; // process group to join: -1 keeps the shell's, 0 starts a new one led by the game
+} SpawnIo;
+
+// SpawnIo that leaves every stream and the process group as the shell has them
+#define SPAWN_IO_INHERIT {NULL, -1, -1, -1, -1}
+
+// start the program at path with argv, without copying the shell's page tables;
+// the game starts with no signals blocked whatever the shell blocks;
+// returns the child pid, or -1 with errno set when the program could not be started
+pid_t spawnGame(const char *path, char *const argv[], const SpawnIo *io);
+
+// same contract as spawnGame, using fork and exec; kept for comparison in spawn-bench
+pid_t forkGame(const char *path, char *const argv[], const SpawnIo *io);
+
+#endif
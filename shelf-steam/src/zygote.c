@@ -0,0 +1,183 @@
+#define _GNU_SOURCE // enable GNU extensions
+#include <errno.h> // include error number library
+#include <fcntl.h> // include file control library
+#include <signal.h> // include signal library
+#include <stdlib.h> // include standard library
+#include <string.h> // include string library
+#include <unistd.h> // include unix standard library
+#include <sys/socket.h> // include socket library
+#include <sys/wait.h> // include wait library
+
+#include "zygote.h"
+
+#define ZYGOTE_MESSAGE 65536 // largest launch request: header, path and arguments
+
+// one idle helper: a small process blocked in recvmsg on its end of sock
+typedef struct {
+    pid_t pid; // helper process, which becomes the game
+    int sock; // shell's end of the helper's socket
+} Zygote;
+
+// fixed part of a launch request, followed by the path and argv as NUL terminated strings
+typedef struct {
+    pid_t pgid; // process group to join, -1 keeps the shell's
+    int argc; // number of arguments after the path
+} ZygoteRequest;
+
+static Zygote pool[MAX_ZYGOTES]; // idle helpers, oldest first
+static int idle = 0; // helpers in pool
+static int wanted = 0; // pool size to refill to
+static char selfPath[4096]; // program the helpers run
+
+static int startHelper(void) {
+    int pair[2]; // shell end, helper end
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0) return -1; // one request per message
+    char *argv[] = {selfPath, ZYGOTE_HELPER_ARG, NULL};
+    SpawnIo io = SPAWN_IO_INHERIT;
+    io.inFd = pair[1]; // the helper reads requests on its stdin
+    pid_t pid = spawnGame(selfPath, argv, &io); // a fresh small process, whatever the shell's size
+    close(pair[1]);
+    if (pid < 0) {
+        close(pair[0]);
+        return -1;
+    }
+    pool[idle].pid = pid;
+    pool[idle].sock = pair[0];
+    idle++;
+    return 0;
+}
+
+int startZygotes(int count) {
+    ssize_t len = readlink("/proc/self/exe", selfPath, sizeof(selfPath) - 1); // helpers are this program in helper mode
+    if (len <= 0) return -1;
+    selfPath[len] = '\0';
+    wanted = count < MAX_ZYGOTES ? count : MAX_ZYGOTES;
+    refillZygotes();
+    return idle > 0 ? 0 : -1;
+}
+
+void refillZygotes(void) {
+    while (idle < wanted && startHelper() == 0) {}
+}
+
+static void dropHelper(Zygote *helper) {
+    close(helper->sock); // the helper sees end of file and exits
+    waitpid(helper->pid, NULL, 0);
+}
+
+void stopZygotes(void) {
+    while (idle > 0) dropHelper(&pool[--idle]);
+    wanted = 0;
+}
+
+// pack path and argv after the header; returns the message length, -1 if it does not fit
+static ssize_t packRequest(char *buffer, const char *path, char *const argv[], pid_t pgid) {
+    ZygoteRequest header = {pgid, 0};
+    size_t used = sizeof(header);
+    for (int i = -1; i < 0 || argv[i]; i++) { // the path first, then every argument
+        const char *text = i < 0 ? path : argv[i];
+        size_t len = strlen(text) + 1;
+        if (used + len > ZYGOTE_MESSAGE) return -1;
+        memcpy(buffer + used, text, len);
+        used += len;
+        if (i >= 0) header.argc++;
+    }
+    memcpy(buffer, &header, sizeof(header));
+    return used;
+}
+
+pid_t zygoteSpawn(const char *path, char *const argv[], const SpawnIo *io) {
+    if (idle == 0) return spawnGame(path, argv, io); // pool used up until the next refill
+
+    static char buffer[ZYGOTE_MESSAGE]; // request being sent
+    ssize_t len = packRequest(buffer, path, argv, io->pgid);
+    if (len < 0) return spawnGame(path, argv, io); // too long for a request
+
+    int inFd = io->inFd >= 0 ? io->inFd : STDIN_FILENO; // the helper's own stdin is its socket
+    if (io->inputFile) { // < redirection is opened here, so errors surface in the shell
+        inFd = open(io->inputFile, O_RDONLY | O_CLOEXEC);
+        if (inFd < 0) return -1;
+    }
+    int fds[3] = {inFd, io->outFd >= 0 ? io->outFd : STDOUT_FILENO, io->errFd >= 0 ? io->errFd : STDERR_FILENO};
+
+    Zygote helper = pool[0]; // the oldest helper is surely waiting in recvmsg by now
+    memmove(pool, pool + 1, --idle * sizeof(Zygote));
+    struct iovec iov = {buffer, len};
+    union { // control buffer, aligned for cmsghdr
+        char data[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data;
+    msg.msg_controllen = sizeof(control.data);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS; // stdin, stdout and stderr travel with the request
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    pid_t pid = -1;
+    if (sendmsg(helper.sock, &msg, MSG_NOSIGNAL) == len) {
+        int childErr = 0;
+        ssize_t n;
+        while ((n = read(helper.sock, &childErr, sizeof(childErr))) < 0 && errno == EINTR) {}
+        if (n == 0) { // the socket closes on exec, so nothing means success
+            pid = helper.pid;
+        } else { // exec failed, the helper reported why and exited
+            waitpid(helper.pid, NULL, 0);
+            errno = n == sizeof(childErr) ? childErr : EIO;
+        }
+        close(helper.sock);
+    } else { // the helper is gone, launch the usual way
+        dropHelper(&helper);
+        pid = spawnGame(path, argv, io);
+    }
+    if (io->inputFile) close(inFd);
+    return pid;
+}
+
+void zygoteHelperMain(void) {
+    static char buffer[ZYGOTE_MESSAGE]; // request being received
+    union { // control buffer, aligned for cmsghdr
+        char data[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {buffer, sizeof(buffer)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data;
+    msg.msg_controllen = sizeof(control.data);
+
+    ssize_t len = recvmsg(STDIN_FILENO, &msg, MSG_CMSG_CLOEXEC); // block until the shell needs a game
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (len < (ssize_t)sizeof(ZygoteRequest) || !cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int))) {
+        _exit(0); // the shell closed the pool
+    }
+    int fds[3]; // stdin, stdout and stderr of the game
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    int replyFd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 3); // closes on exec, which tells the shell it worked
+
+    ZygoteRequest header;
+    memcpy(&header, buffer, sizeof(header));
+    char *argv[header.argc + 1]; // arguments point into the request
+    char *text = buffer + sizeof(header);
+    char *path = text;
+    for (int i = 0; i <= header.argc; i++) { // unpack path and argv
+        text += strlen(text) + 1;
+        argv[i] = i < header.argc ? text : NULL;
+    }
+
+    if (header.pgid >= 0) setpgid(0, header.pgid); // background jobs get their own group
+    for (int i = 0; i < 3; i++) dup2(fds[i], i); // replaces the request socket on stdin too
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] > 2) close(fds[i]);
+    }
+    execv(path, argv); // execute game
+    int err = errno;
+    write(replyFd, &err, sizeof(err)); // report why the game did not start
+    _exit(127); // exit with error
+}
@@ -0,0 +1,26 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <sys/types.h> // include system types library
+
+#include "spawn.h"
+
+#define ZYGOTE_HELPER_ARG "--zygote-helper" // argv[1] that turns a program into a pool helper
+#define MAX_ZYGOTES 16 // largest pool
+
+// keep count idle helpers (capped at MAX_ZYGOTES) started from this same program; returns -1 if none could start
+int startZygotes(int count);
+
+// start helpers to replace the ones used since the last call; meant for idle moments such as the prompt
+void refillZygotes(void);
+
+// close the pool and reap the idle helpers
+void stopZygotes(void);
+
+// spawnGame through an idle helper, which only has to exec; falls back to spawnGame when the pool is empty
+pid_t zygoteSpawn(const char *path, char *const argv[], const SpawnIo *io);
+
+// body of a helper, run by main when argv[1] is ZYGOTE_HELPER_ARG; never returns
+void zygoteHelperMain(void);
+
+#endif